@@ -0,0 +1,359 @@
+#include "archiveprocessor.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <opencv2/videoio.hpp>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include "verifiers/ioukernel.h"
+
+using namespace cv;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+// Used if the file does not tell its frame rate
+const double defaultFps = 25.0;
+}  // namespace
+
+ArchiveProcessor::ArchiveProcessor(const string &_fileName, int _segments,
+                                   int _overlapMs, double _stitchIou,
+                                   const Rect2d &_roi, size_t _frameArenaSize,
+                                   function<Chain()> _chainFactory)
+    : mFileName(_fileName),
+      mSegmentsCount(max(_segments, 1)),
+      mOverlapMs(max(_overlapMs, 0)),
+      mStitchIou(_stitchIou),
+      mRoi(_roi),
+      mFrameArenaSize(_frameArenaSize),
+      mChainFactory(move(_chainFactory)),
+      mFps(defaultFps),
+      mNextTrackId(0),
+      mCancelled(false) {}
+
+bool ArchiveProcessor::run() {
+  int framesCount = 0;
+
+  {
+    VideoCapture capture(mFileName);
+
+    if (!capture.isOpened()) {
+      BOOST_LOG_TRIVIAL(error) << "Archive: can not open " << mFileName;
+      return false;
+    }
+
+    framesCount = static_cast<int>(capture.get(CAP_PROP_FRAME_COUNT));
+    mFps = capture.get(CAP_PROP_FPS);
+  }
+
+  if (mFps <= 0.0) {
+    BOOST_LOG_TRIVIAL(warning) << "Archive: frame rate of " << mFileName
+                               << " is unknown, " << defaultFps << " is used";
+    mFps = defaultFps;
+  }
+
+  int segmentsCount = min(mSegmentsCount, max(framesCount, 1));
+
+  if (framesCount <= 0) {
+    BOOST_LOG_TRIVIAL(warning) << "Archive: frames count of " << mFileName
+                               << " is unknown, it is not split";
+    segmentsCount = 1;
+  }
+
+  mSegments.assign(segmentsCount, Segment());
+
+  for (auto &s : mSegments) {
+    s.chain = mChainFactory();
+
+    if (!s.chain.recognizer || !s.chain.tracker) {
+      BOOST_LOG_TRIVIAL(error) << "Archive: recognizer and tracker are needed";
+      return false;
+    }
+  }
+
+  // Frame timestamps start after recognition delay of just created
+  // recognizers, so sequential run would recognize the first frame
+  int delayMs = mSegments.front().chain.recognizer->recognitionDelayMs();
+  mStart = system_clock::now() + milliseconds(max(delayMs, 0) + 1);
+
+  // Frames recognized by sequential run: the rule of Recognizer applied to
+  // the same timestamps. A segment starts on one of them, then its recognizer
+  // follows the same schedule.
+  vector<int> recognized(1, 0);
+  auto ms = [this](int _index) {
+    return duration_cast<milliseconds>(frameTime(_index).time_since_epoch())
+        .count();
+  };
+
+  for (int i = 1; i < framesCount; ++i)
+    if (ms(i) - ms(recognized.back()) >= delayMs) recognized.push_back(i);
+
+  int overlapFrames = static_cast<int>(lround(mOverlapMs * mFps / 1000.0));
+
+  for (int k = 0; k < segmentsCount; ++k) {
+    Segment &s = mSegments[k];
+
+    s.begin = static_cast<int>(static_cast<long long>(framesCount) * k /
+                               segmentsCount);
+    s.end = k + 1 < segmentsCount
+                ? static_cast<int>(static_cast<long long>(framesCount) *
+                                   (k + 1) / segmentsCount)
+                : numeric_limits<int>::max();  // Up to the real end of file
+    s.overlap = *prev(upper_bound(recognized.begin(), recognized.end(),
+                                  max(s.begin - overlapFrames, 0)));
+  }
+
+  BOOST_LOG_TRIVIAL(info) << "Archive: " << mFileName << ", " << framesCount
+                          << " frames at " << mFps << " fps, "
+                          << segmentsCount << " segments";
+
+  auto t0 = steady_clock::now();
+
+  vector<thread> threads;
+  threads.reserve(mSegments.size());
+
+  for (auto &s : mSegments) threads.emplace_back([this, &s]() { process(s); });
+
+  bool ok = true;
+
+  // Segments are counted in order, while the next ones are still processed
+  for (size_t k = 0; k < mSegments.size(); ++k) {
+    {
+      unique_lock<mutex> lck(mSegmentsMutex);
+      mSegmentDone.wait(lck, [this, k]() { return mSegments[k].done; });
+    }
+
+    if (mSegments[k].failed) {
+      ok = false;
+      mCancelled = true;
+      break;
+    }
+
+    stitch(k > 0 ? &mSegments[k - 1] : nullptr, mSegments[k]);
+    count(mSegments[k]);
+
+    // Tail of this segment is kept to stitch the next one
+    if (k > 0) vector<TrackedFrame>().swap(mSegments[k - 1].frames);
+  }
+
+  for (auto &t : threads) t.join();
+
+  mSegments.clear();
+
+  BOOST_LOG_TRIVIAL(info) << "Archive: " << mFileName
+                          << (ok ? " has been processed" : " has failed")
+                          << " in "
+                          << duration_cast<milliseconds>(steady_clock::now() -
+                                                         t0)
+                                 .count()
+                          << " ms";
+
+  return ok;
+}
+
+time_point<system_clock> ArchiveProcessor::frameTime(int _index) const {
+  return mStart + microseconds(llround(_index * 1000000.0 / mFps));
+}
+
+void ArchiveProcessor::process(Segment &_segment) {
+  VideoCapture capture(mFileName);
+  bool failed = !capture.isOpened();
+
+  if (failed) {
+    BOOST_LOG_TRIVIAL(error) << "Archive: can not open " << mFileName;
+  } else if (_segment.overlap > 0) {
+    // Decoding starts from the key frame before, so the seek is exact for
+    // most containers
+    capture.set(CAP_PROP_POS_FRAMES, _segment.overlap);
+
+    if (static_cast<int>(capture.get(CAP_PROP_POS_FRAMES)) != _segment.overlap)
+      BOOST_LOG_TRIVIAL(warning) << "Archive: seek to frame "
+                                 << _segment.overlap << " is not exact";
+  }
+
+  auto arenaPool = make_shared<FrameArenaPool>(mFrameArenaSize);
+  auto t0 = steady_clock::now();
+  int index = _segment.overlap;
+
+  for (; !failed && index < _segment.end && !mCancelled; ++index) {
+    Mat frame;  // New one every time, trackers may keep views of frames
+
+    if (!capture.read(frame) || frame.empty()) break;
+
+    Rect2d area(0, 0, frame.cols, frame.rows);
+
+    if (!mRoi.empty()) area &= mRoi;
+
+    Rect roi = area;
+
+    list<CapturerOutput> input;
+    input.push_back(CapturerOutput(arenaPool->acquire(),
+                                   make_shared<FrameViews>(frame(roi)),
+                                   frameTime(index)));
+
+    // One frame at a time, so the tracker never skips frames under load
+    _segment.chain.recognizer->push(move(input));
+    _segment.chain.recognizer->doWork();
+    _segment.chain.tracker->push(_segment.chain.recognizer->pop());
+    _segment.chain.tracker->doWork();
+
+    for (const auto &d : _segment.chain.tracker->pop())
+      _segment.frames.push_back(
+          TrackedFrame{d.timestamp, FrameVector<TrackedItem>(d.items)});
+  }
+
+  // Frames of the next segment must not be lost
+  if (!failed && !mCancelled && _segment.end != numeric_limits<int>::max() &&
+      index < _segment.end) {
+    BOOST_LOG_TRIVIAL(error) << "Archive: frame " << index << " of "
+                             << mFileName << " can not be read";
+    failed = true;
+  }
+
+  BOOST_LOG_TRIVIAL(info) << "Archive: frames " << _segment.begin << " - "
+                          << index << " have been tracked in "
+                          << duration_cast<milliseconds>(steady_clock::now() -
+                                                         t0)
+                                 .count()
+                          << " ms";
+
+  // Recognizer and tracker are not needed any more
+  _segment.chain = Chain();
+
+  unique_lock<mutex> lck(mSegmentsMutex);
+
+  _segment.failed = failed;
+  _segment.done = true;
+
+  mSegmentDone.notify_all();
+}
+
+void ArchiveProcessor::stitch(const Segment *_previous, Segment &_segment) {
+  unordered_map<int, int> ids;  // Track id of _segment -> global id
+
+  if (_previous) {
+    // Overlapped frames are tracked by both segments. Score of a pair of
+    // tracks is their IoU summed over these frames and divided by frames,
+    // where any of them is present.
+    map<pair<int, int>, double> iouSums;
+    unordered_map<int, int> previousFrames, frames;
+    map<pair<int, int>, int> bothFrames;
+    BoxesSoA a, b;
+    vector<float> iou;
+
+    for (int i = _segment.overlap; i < _segment.begin; ++i) {
+      size_t p = i - _previous->overlap, s = i - _segment.overlap;
+
+      if (p >= _previous->frames.size() || s >= _segment.frames.size()) break;
+
+      const auto &pItems = _previous->frames[p].items;
+      const auto &sItems = _segment.frames[s].items;
+
+      a.clear();
+      b.clear();
+      for (const auto &item : pItems) {
+        a.push_back(item.rect);
+        ++previousFrames[item.trackId];
+      }
+      for (const auto &item : sItems) {
+        b.push_back(item.rect);
+        ++frames[item.trackId];
+      }
+
+      if (a.size() == 0 || b.size() == 0) continue;
+
+      iou.resize(a.size() * b.size());
+      computeIouMatrix(a, b, iou.data());
+
+      for (size_t r = 0; r < pItems.size(); ++r)
+        for (size_t c = 0; c < sItems.size(); ++c) {
+          auto key = make_pair(pItems[r].trackId, sItems[c].trackId);
+          ++bothFrames[key];
+          if (iou[r * sItems.size() + c] > 0.0f)
+            iouSums[key] += iou[r * sItems.size() + c];
+        }
+    }
+
+    vector<pair<double, pair<int, int>>> candidates;
+
+    for (const auto &sum : iouSums) {
+      int either = previousFrames[sum.first.first] +
+                   frames[sum.first.second] - bothFrames[sum.first];
+      double score = sum.second / max(either, 1);
+
+      if (score >= mStitchIou)
+        candidates.push_back(make_pair(score, sum.first));
+    }
+
+    // Greedy matching, the best pairs first
+    sort(candidates.begin(), candidates.end(),
+         [](const pair<double, pair<int, int>> &_a,
+            const pair<double, pair<int, int>> &_b) {
+           return _a.first > _b.first;
+         });
+
+    unordered_map<int, bool> taken;  // Global ids continued already
+
+    for (const auto &c : candidates) {
+      if (taken[c.second.first] || ids.count(c.second.second)) continue;
+
+      taken[c.second.first] = true;
+      ids[c.second.second] = c.second.first;
+    }
+
+    BOOST_LOG_TRIVIAL(debug) << "Archive: " << ids.size()
+                             << " tracks continued at frame " << _segment.begin;
+  }
+
+  for (auto &f : _segment.frames)
+    for (auto &item : f.items) {
+      auto it = ids.find(item.trackId);
+
+      if (it == ids.end())
+        it = ids.insert(make_pair(item.trackId, mNextTrackId++)).first;
+
+      item.trackId = it->second;
+    }
+}
+
+void ArchiveProcessor::count(const Segment &_segment) {
+  if (!mCrossCounter) return;
+
+  list<TrackerOutput> input;
+  size_t first = _segment.begin - _segment.overlap;
+
+  // Without frames, so there are no shots and snapshots
+  for (size_t i = first; i < _segment.frames.size(); ++i)
+    input.push_back(TrackerOutput(nullptr, nullptr,
+                                  _segment.frames[i].timestamp,
+                                  _segment.frames[i].items));
+
+  if (input.empty()) return;
+
+  mCrossCounter->push(move(input));
+  mCrossCounter->doWork();
+  auto events = mCrossCounter->pop();
+
+  BOOST_LOG_TRIVIAL(info) << "Archive: " << events.size()
+                          << " events from frame " << _segment.begin;
+
+  if (!mWriter) return;
+
+  // Writer thread is not run: events are given to writer by slices, which
+  // fit into its queue, every slice is written and sinks are polled
+  while (!events.empty()) {
+    list<CrossEvent> slice;
+    auto end = events.begin();
+    advance(end, min(mWriter->capacity(), events.size()));
+    slice.splice(slice.end(), events, events.begin(), end);
+
+    mWriter->push(slice);
+    mWriter->flush();
+    mWriter->poll();
+  }
+}
@@ -0,0 +1,108 @@
+#ifndef ARCHIVEPROCESSOR_H
+#define ARCHIVEPROCESSOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+
+#include "crosscounter.h"
+#include "eventwriter.h"
+#include "recognizer.h"
+#include "tracker.h"
+
+// Counts recorded file faster than real time. The file is split into
+// segments, which are decoded, recognized and tracked in parallel, each by
+// its own recognizer and tracker. Every segment but the first one starts
+// _overlapMs earlier, its tracks on these frames are matched by IoU to tracks
+// of the previous segment, so tracks crossing the boundary keep their ids.
+// Then segments are counted in order by one CrossCounter, as the whole file
+// would be counted.
+//
+// Frames are fed one by one, so nothing is skipped or interpolated, and
+// overlap starts on a frame, which sequential run recognizes too. Event
+// timestamps are start of the run plus position in the file.
+//
+// tests/archivetest.cpp checks, that events are equal to sequential run,
+// with a fake tracker, which follows cars exactly. Real trackers are not
+// reproducible so: CvTracker may differ near boundaries, where its state is
+// built from the overlap only, and BudgetTracker chooses algorithms by
+// measured wall clock time, so even two single segment runs may differ.
+//
+// Writer thread is not run: events are flushed and sinks are polled after
+// every slice. Buckets of AggregationSink later than wall clock minus its
+// lateMinutes stay in memory until the sink is closed.
+class ArchiveProcessor {
+ public:
+  // Recognizer and tracker of one segment
+  struct Chain {
+    std::shared_ptr<Recognizer> recognizer;
+    std::shared_ptr<Tracker> tracker;
+  };
+
+  explicit ArchiveProcessor(const std::string &_fileName, int _segments,
+                            int _overlapMs, double _stitchIou,
+                            const cv::Rect2d &_roi, size_t _frameArenaSize,
+                            std::function<Chain()> _chainFactory);
+
+  // Optional, must be set before run()
+  void setCrossCounter(const std::shared_ptr<CrossCounter> &_cc) {
+    mCrossCounter = _cc;
+  }
+  void setEventWriter(const std::shared_ptr<EventWriter> &_writer) {
+    mWriter = _writer;
+  }
+
+  // Processes the whole file, false if some part of it can not be read
+  bool run();
+
+ protected:
+  struct TrackedFrame {
+    std::chrono::time_point<std::chrono::system_clock> timestamp;
+    FrameVector<TrackedItem> items;  // On the heap
+  };
+
+  struct Segment {
+    // Frames from overlap to begin are used only to stitch tracks
+    int overlap, begin, end;
+    Chain chain;
+    std::vector<TrackedFrame> frames;  // From overlap
+    bool done, failed;
+
+    Segment() : overlap(0), begin(0), end(0), done(false), failed(false) {}
+  };
+
+  std::string mFileName;
+  int mSegmentsCount;
+  int mOverlapMs;
+  double mStitchIou;
+  cv::Rect2d mRoi;
+  size_t mFrameArenaSize;
+  std::function<Chain()> mChainFactory;
+  std::shared_ptr<CrossCounter> mCrossCounter;
+  std::shared_ptr<EventWriter> mWriter;
+
+  double mFps;
+  std::chrono::time_point<std::chrono::system_clock> mStart;
+  int mNextTrackId;  // For tracks not continued from previous segment
+  std::atomic<bool> mCancelled;
+
+  std::vector<Segment> mSegments;
+  std::mutex mSegmentsMutex;
+  std::condition_variable mSegmentDone;
+
+  std::chrono::time_point<std::chrono::system_clock> frameTime(
+      int _index) const;
+  void process(Segment &_segment);
+  // Maps track ids of _segment to global ids, _previous is nullptr for the
+  // first segment
+  void stitch(const Segment *_previous, Segment &_segment);
+  void count(const Segment &_segment);
+};
+
+#endif  // ARCHIVEPROCESSOR_H
@@ -0,0 +1,58 @@
+#include "archiveprocessorfactory.h"
+
+#include <opencv2/core/core.hpp>
+
+#include "recognizerfactory.h"
+#include "trackerfactory.h"
+
+using namespace cv;
+using namespace std;
+using namespace nlohmann;
+
+shared_ptr<ArchiveProcessor> ArchiveProcessorFactory::createArchiveProcessor(
+    const json &_config, const json &_capturerConfig,
+    const json &_recognizerConfig, const json &_trackerConfig) {
+  bool on = _config.contains("on") && _config["on"].is_boolean()
+                ? _config["on"].get<bool>()
+                : false;
+
+  if (!on) return nullptr;
+
+  Rect2d rect;
+
+  if (_capturerConfig.contains("roiX") &&
+      _capturerConfig["roiX"].is_number() &&
+      _capturerConfig.contains("roiY") &&
+      _capturerConfig["roiY"].is_number() &&
+      _capturerConfig.contains("roiW") &&
+      _capturerConfig["roiW"].is_number() &&
+      _capturerConfig.contains("roiH") && _capturerConfig["roiH"].is_number())
+    rect = Rect2d(_capturerConfig["roiX"].get<double>(),
+                  _capturerConfig["roiY"].get<double>(),
+                  _capturerConfig["roiW"].get<double>(),
+                  _capturerConfig["roiH"].get<double>());
+
+  return shared_ptr<ArchiveProcessor>(new ArchiveProcessor(
+      _config.contains("file") && _config["file"].is_string()
+          ? _config["file"].get<string>()
+          : "",
+      _config.contains("segments") && _config["segments"].is_number()
+          ? _config["segments"].get<int>()
+          : 4,
+      _config.contains("overlapMs") && _config["overlapMs"].is_number()
+          ? _config["overlapMs"].get<int>()
+          : 2000,
+      _config.contains("stitchIou") && _config["stitchIou"].is_number()
+          ? _config["stitchIou"].get<double>()
+          : 0.3,
+      rect,
+      _capturerConfig.contains("frameArenaSize") &&
+              _capturerConfig["frameArenaSize"].is_number()
+          ? _capturerConfig["frameArenaSize"].get<size_t>()
+          : 64 * 1024,
+      [_recognizerConfig, _trackerConfig]() {
+        return ArchiveProcessor::Chain{
+            RecognizerFactory::createRecognizer(_recognizerConfig),
+            TrackerFactory::createTracker(_trackerConfig)};
+      }));
+}
@@ -0,0 +1,24 @@
+#ifndef ARCHIVEPROCESSORFACTORY_H
+#define ARCHIVEPROCESSORFACTORY_H
+
+#include <memory>
+#include <nlohmann/json.hpp>
+
+#include "archiveprocessor.h"
+
+class ArchiveProcessorFactory {
+ public:
+  virtual ~ArchiveProcessorFactory() {}
+
+  // Every segment gets recognizer and tracker made of their configs, roi and
+  // frame arena size are those of capturer
+  static std::shared_ptr<ArchiveProcessor> createArchiveProcessor(
+      const nlohmann::json &_config, const nlohmann::json &_capturerConfig,
+      const nlohmann::json &_recognizerConfig,
+      const nlohmann::json &_trackerConfig);
+
+ private:
+  explicit ArchiveProcessorFactory() {}
+};
+
+#endif  // ARCHIVEPROCESSORFACTORY_H
@@ -0,0 +1,127 @@
+// Conversions per frame, when stages convert captured frame on their own and
+// when they share FrameViews, for decoded and MJPEG frames. Stage requests
+// are of a typical config: 1280x720 frames, tracker at 640x360 with 6 crop
+// slots, 300x300 network input and 960x540 debug video. Blob of FrameViews
+// must be exactly blobFromImage of full size frame. With --quick only a few
+// frames are run, so ctest runs it fast.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <opencv2/dnn.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <vector>
+
+#include "frameviews.h"
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+const Size imageSize(1280, 720), trackSize(640, 360), slotSize(120, 80),
+    netSize(300, 300), videoSize(960, 540);
+const int slots = 6;
+
+Rect slotWindow(int _i) { return Rect(100 + 150 * _i, 300, 240, 160); }
+
+// Smooth random picture, so that its JPEG is of usual size
+Mat picture() {
+  Mat noise(Size(imageSize.width / 8, imageSize.height / 8), CV_8UC3), image;
+  randu(noise, Scalar::all(0), Scalar::all(255));
+  resize(noise, image, imageSize, 0, 0, INTER_CUBIC);
+
+  return image;
+}
+
+bool equal(const Mat &_a, const Mat &_b) {
+  return _a.size == _b.size && _a.type() == _b.type() &&
+         norm(_a, _b, NORM_INF) == 0.0;
+}
+
+FrameViews::Statistics operator-(const FrameViews::Statistics &_a,
+                                 const FrameViews::Statistics &_b) {
+  return FrameViews::Statistics{_a.frames - _b.frames,
+                                _a.decodes - _b.decodes,
+                                _a.conversions - _b.conversions,
+                                _a.resizes - _b.resizes,
+                                _a.blobs - _b.blobs,
+                                _a.hits - _b.hits};
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+  int frames = quick ? 5 : 200;
+
+  Mat image = picture();
+  auto jpeg = make_shared<vector<unsigned char>>();
+  imencode(".jpg", image, *jpeg, {IMWRITE_JPEG_QUALITY, 90});
+
+  // Every stage converts the frame itself
+  auto t0 = chrono::steady_clock::now();
+  for (int f = 0; f < frames; ++f) {
+    Mat gray, slot, blob, video;
+
+    cvtColor(image, gray, COLOR_BGR2GRAY);
+    resize(gray, gray, trackSize, 0, 0, INTER_AREA);
+    for (int s = 0; s < slots; ++s) {
+      resize(image(slotWindow(s)), slot, slotSize, 0, 0, INTER_AREA);
+      cvtColor(slot, slot, COLOR_BGR2GRAY);
+    }
+    blob = dnn::blobFromImage(image, 1.0, netSize);
+    resize(image, video, videoSize);
+  }
+  double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0)
+                  .count();
+  printf("%-20s %8.2f ms per frame, 7 conversions, 8 resizes, 1 blob\n",
+         "stages (decoded)", ms / frames);
+
+  bool ok = true;
+
+  for (bool compressed : {false, true}) {
+    const char *name = compressed ? "FrameViews (MJPEG)" : "FrameViews (BGR)";
+    auto s0 = FrameViews::statistics();
+
+    t0 = chrono::steady_clock::now();
+    for (int f = 0; f < frames; ++f) {
+      auto views = compressed ? make_shared<FrameViews>(
+                                    jpeg, imageSize, Rect(Point(), imageSize))
+                              : make_shared<FrameViews>(image);
+
+      views->gray(trackSize);
+      for (int s = 0; s < slots; ++s) views->gray(slotWindow(s), slotSize);
+      Mat blob = views->blob(1.0, netSize, Scalar(), false, false, CV_32F);
+      // Second consumer of the same views, as the next tracker call
+      views->gray(trackSize);
+      views->bgr(videoSize).clone();
+
+      // Network input is not changed by sharing
+      if (f == 0 &&
+          !equal(blob, dnn::blobFromImage(views->bgr(), 1.0, netSize))) {
+        printf("%s: blob differs from blobFromImage of full frame\n", name);
+        ok = false;
+      }
+    }
+    ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0)
+             .count();
+
+    printf("%-20s %8.2f ms per frame, %s\n", name, ms / frames,
+           (FrameViews::statistics() - s0).toString().c_str());
+  }
+
+  // Decoded frame gives the same blob as the image itself
+  FrameViews views(image);
+  if (!equal(views.blob(1.0, netSize, Scalar(), false, false, CV_32F),
+             dnn::blobFromImage(image, 1.0, netSize))) {
+    printf("Blob of decoded frame differs from blobFromImage\n");
+    ok = false;
+  }
+
+  printf(ok ? "Blobs are equal\n" : "Blobs differ\n");
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -10,7 +10,7 @@
 // by Cong Ma, 2016
 //
 
-#include "verifiers/hungarian.h"
+#include "bench/hungarian.h"
 
 #include <cmath>
 #include <limits>
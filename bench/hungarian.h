@@ -9,9 +9,12 @@
 // Both this code and the orignal code are published under the BSD license.
 // by Cong Ma, 2016
 //
+// The solver HunVerifier used before LapSolver, kept as reference for
+// lapsolverbench.
+//
 
-#ifndef VERIFIERS_HUNGARIAN_H
-#define VERIFIERS_HUNGARIAN_H
+#ifndef BENCH_HUNGARIAN_H
+#define BENCH_HUNGARIAN_H
 
 #include <vector>
 
@@ -22,4 +25,4 @@ double Solve(std::vector<std::vector<double>>& DistMatrix,
 
 }
 
-#endif  // VERIFIERS_HUNGARIAN_H
+#endif  // BENCH_HUNGARIAN_H
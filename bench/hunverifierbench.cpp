@@ -0,0 +1,108 @@
+// HunVerifier::verify on a busy scene: 40 tracked cars and 40 detections per
+// frame, a few detections are missed and come back. Measures time and heap
+// allocations per frame after warm-up, when the workspace is grown already.
+// Every detected car must keep its track, missed ones are kept by
+// maxRecFails. With --quick only a few frames are run, so ctest runs it fast.
+#include <boost/log/core.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "verifiers/hunverifier.h"
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+// Heap allocations of the whole program
+size_t allocations = 0;
+
+// Cars in the scene, also tracks kept by the verifier
+const int cars = 40;
+// Frames before measurement, workspace grows during them
+const int warmUpFrames = 10;
+
+// Detections of the scene at _frame, car _frame % cars is missed
+void detect(int _frame, mt19937 &_rng, FrameVector<RecognizedItem> &_r) {
+  normal_distribution<double> jitter(0.0, 1.5);
+
+  _r.clear();
+  for (int i = 0; i < cars; ++i) {
+    if (i == _frame % cars) continue;
+
+    // Ten lanes of four cars, moving back and forth
+    double x = i / 10 * 450.0 + 150.0 * (1.0 + sin(_frame * 0.02));
+    double y = (i % 10) * 100.0 + 20.0;
+
+    _r.push_back(RecognizedItem(
+        2, 0.9, Rect2d(x + jitter(_rng), y + jitter(_rng), 120.0, 70.0)));
+  }
+}
+
+}  // namespace
+
+void *operator new(size_t _size) {
+  ++allocations;
+
+  if (void *p = malloc(_size ? _size : 1)) return p;
+
+  throw bad_alloc();
+}
+
+void operator delete(void *_p) noexcept { free(_p); }
+
+void operator delete(void *_p, size_t) noexcept { free(_p); }
+
+int main(int argc, char *argv[]) {
+  bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+  int frames = quick ? 100 : 20000;
+
+  boost::log::core::get()->set_logging_enabled(false);
+
+  HunVerifier verifier(0.3, 2);
+  auto weakFit = [](const RecognizedItem &) { return true; };
+  auto strongFit = [](const RecognizedItem &_r) { return _r.confidence > 0.5; };
+
+  mt19937 rng(1);
+  FrameVector<TrackedItem> tracks;
+  FrameVector<RecognizedItem> detections;
+  tracks.reserve(2 * cars);
+  detections.reserve(cars);
+
+  bool ok = true;
+  double us = 0.0;
+  size_t allocated = 0;
+
+  for (int f = 0; f < warmUpFrames + frames; ++f) {
+    detect(f, rng, detections);
+
+    size_t a0 = allocations;
+    auto t0 = chrono::steady_clock::now();
+    verifier.verify(tracks, detections, weakFit, strongFit);
+    auto t1 = chrono::steady_clock::now();
+
+    if (f >= warmUpFrames) {
+      us += chrono::duration<double, micro>(t1 - t0).count();
+      allocated += allocations - a0;
+    }
+
+    // A car is missed for one frame only, so it is never dropped or doubled
+    if (f > 0 && tracks.size() != static_cast<size_t>(cars)) {
+      printf("frame %d: %d tracks instead of %d\n", f,
+             static_cast<int>(tracks.size()), cars);
+      ok = false;
+    }
+  }
+
+  printf("%dx%d, %d frames: %.2f us, %.3f allocations per frame\n", cars,
+         cars, frames, us / frames, static_cast<double>(allocated) / frames);
+  printf(ok ? "Tracks are kept\n" : "Tracks are lost\n");
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
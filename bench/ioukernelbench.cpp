@@ -0,0 +1,128 @@
+// IOU matrix of the kernel (SIMD if compiled in) against its scalar path and
+// against per-pair getIOU, which it replaced. Boxes are random, with empty,
+// equal and disjoint ones, sizes are not multiples of SIMD width, so the
+// scalar tail is checked too. With --quick only small sizes are checked, so
+// ctest runs it fast.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <opencv2/core/hal/intrin.hpp>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "utilities.h"
+#include "verifiers/ioukernel.h"
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+// SIMD and scalar paths do the same float operations
+const float simdTolerance = 1e-6f;
+// Kernel rounds coordinates to float, getIOU is double
+const double pairTolerance = 1e-3;
+
+vector<Rect2d> randomBoxes(int _count, mt19937 &_rng) {
+  uniform_real_distribution<double> pos(0.0, 600.0), size(0.0, 200.0);
+  vector<Rect2d> boxes;
+
+  for (int i = 0; i < _count; ++i) {
+    switch (i % 8) {
+      case 0:  // Empty
+        boxes.push_back(Rect2d(pos(_rng), pos(_rng), 0.0, size(_rng)));
+        break;
+      case 1:  // Equal to the previous one
+        boxes.push_back(boxes.back());
+        break;
+      case 2:  // Far from all others
+        boxes.push_back(Rect2d(5000.0 + pos(_rng), 5000.0, 10.0, 10.0));
+        break;
+      default:
+        boxes.push_back(
+            Rect2d(pos(_rng), pos(_rng), size(_rng) + 1.0, size(_rng) + 1.0));
+    }
+  }
+
+  return boxes;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+
+  const vector<pair<int, int>> sizes = {
+      {1, 1}, {7, 13}, {40, 40}, {40, 37}, {200, 203}, {1000, 1000}};
+
+#if CV_SIMD
+  printf("SIMD: %d float lanes\n", static_cast<int>(v_float32::nlanes));
+#else
+  printf("SIMD: not available, the kernel is scalar\n");
+#endif
+
+  mt19937 rng(1);
+  bool ok = true;
+
+  printf("%11s %8s %12s %12s %12s\n", "size", "repeats", "kernel, us",
+         "scalar, us", "getIOU, us");
+
+  for (const auto &s : sizes) {
+    int rows = s.first, cols = s.second;
+
+    if (quick && rows * cols > 200 * 203) continue;
+
+    int repeats = quick ? 3 : min(100000, max(3, 20000000 / (rows * cols)));
+    double kernelUs = 0.0, scalarUs = 0.0, pairUs = 0.0;
+
+    vector<Rect2d> a = randomBoxes(rows, rng), b = randomBoxes(cols, rng);
+    BoxesSoA aSoA, bSoA;
+
+    for (const auto &r : a) aSoA.push_back(r);
+    for (const auto &r : b) bSoA.push_back(r);
+
+    vector<float> kernel(rows * cols), scalar(rows * cols);
+    vector<double> pairs(rows * cols);
+
+    for (int i = 0; i < repeats; ++i) {
+      auto t0 = chrono::steady_clock::now();
+      computeIouMatrix(aSoA, bSoA, kernel.data());
+      auto t1 = chrono::steady_clock::now();
+      computeIouMatrixScalar(aSoA, bSoA, scalar.data());
+      auto t2 = chrono::steady_clock::now();
+      for (int r = 0; r < rows; ++r)
+        for (int c = 0; c < cols; ++c)
+          pairs[r * cols + c] = getIOU(a[r], b[c]);
+      auto t3 = chrono::steady_clock::now();
+
+      kernelUs += chrono::duration<double, micro>(t1 - t0).count();
+      scalarUs += chrono::duration<double, micro>(t2 - t1).count();
+      pairUs += chrono::duration<double, micro>(t3 - t2).count();
+    }
+
+    float simdDiff = 0.0f;
+    double pairDiff = 0.0;
+
+    for (int i = 0; i < rows * cols; ++i) {
+      simdDiff = max(simdDiff, fabs(kernel[i] - scalar[i]));
+      pairDiff = max(pairDiff, fabs(kernel[i] - pairs[i]));
+    }
+
+    if (simdDiff > simdTolerance || pairDiff > pairTolerance) {
+      printf("%4dx%-4d mismatch: SIMD - scalar %g, kernel - getIOU %g\n", rows,
+             cols, simdDiff, pairDiff);
+      ok = false;
+    }
+
+    printf("%5dx%-5d %8d %12.2f %12.2f %12.2f\n", rows, cols, repeats,
+           kernelUs / repeats, scalarUs / repeats, pairUs / repeats);
+  }
+
+  printf(ok ? "IOU values are equal\n" : "IOU values differ\n");
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
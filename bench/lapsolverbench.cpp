@@ -0,0 +1,102 @@
+// LapSolver against the Hungarian solver it replaced, on random dense cost
+// matrices up to 500x500. Both must find the same optimal cost, LapSolver
+// assignment must be a valid matching of that cost. With --quick only small
+// sizes are checked, so ctest runs it fast.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "bench/hungarian.h"
+#include "verifiers/lapsolver.h"
+
+using namespace std;
+
+namespace {
+
+// Cost of _solver assignment, -1 if it is not a matching of min(rows, cols)
+double assignmentCost(const LapSolver &_solver, const vector<double> &_cost,
+                      int _rows, int _cols) {
+  vector<char> used(_cols, 0);
+  double sum = 0.0;
+  int assigned = 0;
+
+  for (int r = 0; r < _rows; ++r) {
+    int c = _solver.rowAssignment()[r];
+    if (c < 0) continue;
+    if (c >= _cols || used[c]) return -1.0;
+
+    used[c] = 1;
+    sum += _cost[r * _cols + c];
+    ++assigned;
+  }
+
+  return assigned == min(_rows, _cols) ? sum : -1.0;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+
+  const vector<pair<int, int>> sizes = {
+      {10, 10},   {50, 50},   {100, 100}, {200, 200},
+      {500, 500}, {100, 40},  {40, 100},  {500, 200}};
+
+  mt19937 rng(1);
+  uniform_real_distribution<double> random(0.0, 1.0);
+  LapSolver solver;  // Reused, as in HunVerifier
+  bool ok = true;
+
+  printf("%9s %8s %14s %14s\n", "size", "repeats", "Hungarian, ms",
+         "LapSolver, ms");
+
+  for (const auto &s : sizes) {
+    int rows = s.first, cols = s.second;
+
+    if (quick && rows * cols > 100 * 100) continue;
+
+    int repeats = quick ? 3 : max(3, 2000000 / (rows * cols * 4));
+    double hungarianMs = 0.0, lapMs = 0.0;
+
+    for (int i = 0; i < repeats; ++i) {
+      vector<double> cost(rows * cols);
+      vector<vector<double>> nested(rows, vector<double>(cols));
+
+      for (int r = 0; r < rows; ++r)
+        for (int c = 0; c < cols; ++c)
+          nested[r][c] = cost[r * cols + c] = random(rng);
+
+      vector<int> assignment;
+      auto t0 = chrono::steady_clock::now();
+      double hungarianCost = Hungarian::Solve(nested, assignment);
+      auto t1 = chrono::steady_clock::now();
+      double lapCost = solver.solve(cost.data(), rows, cols);
+      auto t2 = chrono::steady_clock::now();
+
+      hungarianMs += chrono::duration<double, milli>(t1 - t0).count();
+      lapMs += chrono::duration<double, milli>(t2 - t1).count();
+
+      double checked = assignmentCost(solver, cost, rows, cols);
+
+      if (fabs(hungarianCost - lapCost) > 1e-9 * rows ||
+          fabs(checked - lapCost) > 1e-9 * rows) {
+        printf("%4dx%-4d mismatch: Hungarian %.9f, LapSolver %.9f (%.9f)\n",
+               rows, cols, hungarianCost, lapCost, checked);
+        ok = false;
+      }
+    }
+
+    printf("%4dx%-4d %8d %14.3f %14.3f\n", rows, cols, repeats,
+           hungarianMs / repeats, lapMs / repeats);
+  }
+
+  printf(ok ? "Costs are equal\n" : "Costs differ\n");
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
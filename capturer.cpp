@@ -3,13 +3,28 @@
 #include <boost/log/trivial.hpp>
 #include <opencv2/imgcodecs.hpp>
 
+#include "cliprecorder.h"
+
+#ifdef __linux__
+#include "v4l2device.h"
+#endif
+
 using namespace cv;
 using namespace std;
 
+namespace {
+
+// Statistics are logged every this number of grabbed (live mode) and pushed
+// frames
+const long statisticsPeriod = 1000;
+
+}  // namespace
+
 Capturer::Capturer(string _source, int _settedFrameWidth,
                    int _settedFrameHeight, string _settedCodec, int _settedFps,
                    Rect2d _roi, int _framesDelayMs, string _origFrameName,
-                   int _timeoutMs)
+                   size_t _frameArenaSize, bool _rawMjpeg, bool _liveMode,
+                   int _v4l2Buffers, int _timeoutMs)
     : mSource(move(_source)),
       mSettedFrameWidth(_settedFrameWidth),
       mSettedFrameHeight(_settedFrameHeight),
@@ -18,9 +33,37 @@ Capturer::Capturer(string _source, int _settedFrameWidth,
       mRoi(move(_roi)),
       mFramesDelayMs(_framesDelayMs),
       mOrigFrameName(move(_origFrameName)),
+      mRawMjpeg(_rawMjpeg),
+      mLiveMode(_liveMode),
+      mV4l2Buffers(_v4l2Buffers),
       mTimeoutMs(_timeoutMs),
       mPrevFrameTs(chrono::system_clock::now()),
-      mMustDoOrig(mOrigFrameName.empty() ? false : true) {
+      mMustDoOrig(mOrigFrameName.empty() ? false : true),
+      mArenaPool(new FrameArenaPool(_frameArenaSize)),
+      mRequested(false),
+      mGrabbed(0),
+      mRetrieved(0) {
+#ifndef __linux__
+  if (mV4l2Buffers > 0) {
+    BOOST_LOG_TRIVIAL(warning)
+        << "V4L2 capture is supported on Linux only, v4l2Buffers is off";
+    mV4l2Buffers = 0;
+  }
+#endif
+
+  openCapture();
+}
+
+void Capturer::openCapture() {
+#ifdef __linux__
+  if (mV4l2Buffers > 0) {
+    mDevice = make_shared<V4l2Device>(
+        mSource.empty() ? "/dev/video0" : mSource, mSettedFrameWidth,
+        mSettedFrameHeight, mSettedCodec, mSettedFps, mV4l2Buffers);
+    return;
+  }
+#endif
+
   mCvCapture = mSource.empty() ? VideoCapture(0) : VideoCapture(mSource);
 
   // For getting cam info use "sudo v4l2-ctl -d /dev/video0 --list-formats-ext"
@@ -36,60 +79,232 @@ Capturer::Capturer(string _source, int _settedFrameWidth,
                                        mSettedCodec[2], mSettedCodec[3]));
 
   if (mSettedFps > 0) mCvCapture.set(CAP_PROP_FPS, mSettedFps);
+
+  // V4L2 backend gives MJPEG buffers as is without conversion, FFmpeg backend
+  // gives raw packets with format -1
+  if (mRawMjpeg) {
+    mCvCapture.set(CAP_PROP_CONVERT_RGB, 0);
+    mCvCapture.set(CAP_PROP_FORMAT, -1);
+  }
+
+  // Backends, which support it, keep only one frame queued
+  if (mLiveMode) mCvCapture.set(CAP_PROP_BUFFERSIZE, 1);
+}
+
+void Capturer::reopenCapture() {
+  this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  mCvCapture.release();
+  mDevice.reset();
+  openCapture();
+
+  BOOST_LOG_TRIVIAL(warning)
+      << "Frame is empty, video capturer has been reopened";
 }
 
 list<CapturerOutput> Capturer::pop() {
   unique_lock<mutex> lck(mOutputMutex);
 
+  if (mLiveMode) mRequested = true;
+
   if (mOutputData.empty())
     mHaveOutput.wait_for(lck, chrono::milliseconds(mTimeoutMs));
 
+  // Frame, which is grabbed after timeout, would be stale at the next pop()
+  mRequested = false;
+
   return move(mOutputData);
 }
 
 void Capturer::doWork() {
+#ifdef __linux__
+  if (mDevice) {
+    readDevice();
+    return;
+  }
+#endif
+
   Mat frame;
-  mCvCapture >> frame;
+  bool wanted = true;  // Frame goes to the pipeline
+  auto ts = chrono::system_clock::now();
 
-  if (!frame.empty() && mMustDoOrig) {
-    imwrite(mOrigFrameName, frame);
-    mMustDoOrig = false;
+  if (mLiveMode) {
+    if (!mCvCapture.grab()) {
+      reopenCapture();
+      return;
+    }
+
+    ts = chrono::system_clock::now();
+
+    {
+      unique_lock<mutex> lck(mOutputMutex);
+      wanted = mRequested && mOutputData.empty();
+
+      if (++mGrabbed % statisticsPeriod == 0)
+        BOOST_LOG_TRIVIAL(debug) << "Capturer: " << mGrabbed
+                                 << " frames grabbed, " << mRetrieved
+                                 << " retrieved";
+    }
+
+    if (!wanted && !(mClipRecorder && mRawMjpeg)) return;
+
+    mCvCapture.retrieve(frame);
+  } else {
+    mCvCapture >> frame;
+  }
+
+  JpegBuffer jpeg;
+  Size imageSize;
+
+  // Raw frame is a row of JPEG bytes, starting with SOI marker
+  if (mRawMjpeg && !frame.empty()) {
+    if (frame.rows == 1 && frame.type() == CV_8UC1 && frame.total() > 2 &&
+        frame.data[0] == 0xff && frame.data[1] == 0xd8) {
+      // Capture buffer is reused by the backend, so it is copied once
+      auto buf = make_shared<vector<unsigned char>>(
+          frame.data, frame.data + frame.total());
+      jpeg = buf;
+
+      // Not wanted live frame is kept for clips only
+      if (!wanted) {
+        mClipRecorder->pushFrame(ts, jpeg);
+        return;
+      }
+
+      // Frame is decoded by stages, only to the forms they need
+      if (!JpegDecoder::readSize(*buf, imageSize)) {
+        BOOST_LOG_TRIVIAL(warning) << "Broken MJPEG frame has been skipped";
+        return;
+      }
+    } else {
+      // Frame is in some unconverted format, it is dropped
+      BOOST_LOG_TRIVIAL(warning)
+          << "Video source does not give raw MJPEG frames, rawMjpeg is off";
+      mRawMjpeg = false;
+      mCvCapture.set(CAP_PROP_CONVERT_RGB, 1);
+      mCvCapture.set(CAP_PROP_FORMAT, CV_8UC3);
+      return;
+    }
+  } else if (!frame.empty()) {
+    imageSize = frame.size();
   }
 
   // assert(!frame.empty());
   if (frame.empty()) {
-    this_thread::sleep_for(std::chrono::milliseconds(500));
+    reopenCapture();
+    return;
+  }
 
-    mCvCapture.release();
-    mCvCapture = VideoCapture(mSource.empty() ? 0 : mSource);
+  if (!mLiveMode) {
+    // Delay for video replaing
+    if (mFramesDelayMs > 0)
+      this_thread::sleep_for(std::chrono::milliseconds(mFramesDelayMs));
 
-    BOOST_LOG_TRIVIAL(warning)
-        << "Frame is empty, video capturer has been reopened";
+    ts = chrono::system_clock::now();
+  }
+
+  pushFrame(mRawMjpeg ? Mat() : frame, jpeg, imageSize, ts, nullptr);
+}
+
+#ifdef __linux__
+void Capturer::readDevice() {
+  V4l2Device::Frame frame;
+
+  // Live device gives the newest of ready frames
+  if (!mDevice->read(frame, mTimeoutMs, mLiveMode)) {
+    if (!mDevice->isOpened()) reopenCapture();
     return;
   }
 
-  // Delay for video replaing
-  if (mFramesDelayMs > 0)
-    this_thread::sleep_for(std::chrono::milliseconds(mFramesDelayMs));
+  bool wanted = true;
 
-  auto ts = chrono::system_clock::now();
+  if (mLiveMode) {
+    unique_lock<mutex> lck(mOutputMutex);
+    wanted = mRequested && mOutputData.empty();
+
+    if (++mGrabbed % statisticsPeriod == 0)
+      BOOST_LOG_TRIVIAL(debug) << "Capturer: " << mGrabbed
+                               << " frames grabbed, " << mRetrieved
+                               << " retrieved";
+  }
+
+  if (!wanted && !(mClipRecorder && frame.compressed)) return;
+
+  if (frame.compressed) {
+    // Driver buffer is given back at once, clips keep frames for seconds
+    auto jpeg = make_shared<vector<unsigned char>>(
+        frame.image.data, frame.image.data + frame.image.total());
+    frame.lease.reset();
+
+    if (!wanted) {
+      mClipRecorder->pushFrame(frame.timestamp, jpeg);
+      return;
+    }
+
+    Size imageSize;
+
+    if (!JpegDecoder::readSize(*jpeg, imageSize)) {
+      BOOST_LOG_TRIVIAL(warning) << "Broken MJPEG frame has been skipped";
+      return;
+    }
+
+    pushFrame(Mat(), jpeg, imageSize, frame.timestamp, nullptr);
+  } else {
+    Mat image = mDevice->bgr(frame);
+
+    pushFrame(image, nullptr, image.size(), frame.timestamp, frame.lease);
+  }
+}
+#endif
+
+void Capturer::pushFrame(const Mat &_frame, JpegBuffer _jpeg,
+                         const Size &_imageSize,
+                         const chrono::time_point<chrono::system_clock> &_ts,
+                         const shared_ptr<void> &_lease) {
+  if (mClipRecorder) {
+    if (_jpeg) {
+      mClipRecorder->pushFrame(_ts, _jpeg);
+    } else if (mClipRecorder->encodesDecoded()) {
+      // Encoded by the recorder; frame in driver buffer is copied, so the
+      // buffer is not held by the recorder
+      mClipRecorder->pushImage(_ts, _lease ? _frame.clone() : _frame);
+    }
+  }
+
+  Rect roi(0, 0, _imageSize.width, _imageSize.height);
 
   if (!mRoi.empty()) {
-    Rect2d roi(mRoi);
+    Rect2d r(mRoi);
+
+    if (r.x < 0) r.x = 0;
+    if (r.y < 0) r.y = 0;
+    if (r.x + r.width > _imageSize.width) r.width = _imageSize.width - r.x;
+    if (r.y + r.height > _imageSize.height)
+      r.height = _imageSize.height - r.y;
 
-    if (roi.x < 0) roi.x = 0;
-    if (roi.y < 0) roi.y = 0;
-    if (roi.x + roi.width > frame.cols) roi.width = frame.cols - roi.x;
-    if (roi.y + roi.height > frame.rows) roi.height = frame.rows - roi.y;
+    roi = r;
+  }
+
+  auto views = _frame.empty()
+                   ? make_shared<FrameViews>(_jpeg, _imageSize, roi)
+                   : make_shared<FrameViews>(_frame(roi), _lease);
 
-    frame = frame(roi);
+  if (mMustDoOrig) {
+    imwrite(mOrigFrameName, views->bgr());
+    mMustDoOrig = false;
   }
 
   unique_lock<mutex> lck(mOutputMutex);
 
-  mOutputData.push_back(CapturerOutput(frame, ts));
+  mOutputData.push_back(CapturerOutput(mArenaPool->acquire(), views, _ts));
+  ++mRetrieved;
 
   BOOST_LOG_TRIVIAL(trace) << "Pushed new frame";
 
+  // Conversions of pushed frames, done by all stages
+  if (mRetrieved % statisticsPeriod == 0)
+    BOOST_LOG_TRIVIAL(debug)
+        << "Frame views: " << FrameViews::statistics().toString();
+
   mHaveOutput.notify_all();
 }
@@ -4,6 +4,7 @@
 #include <chrono>
 #include <condition_variable>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <opencv2/core/core.hpp>
 #include <opencv2/videoio.hpp>
@@ -11,29 +12,43 @@
 #include <thread>
 #include <utility>
 
+#include "framearena.h"
+#include "frameviews.h"
+
+class ClipRecorder;
+class V4l2Device;
+
 struct CapturerOutput {
-  cv::Mat frame;
+  // Memory for transient data of the frame, declared first to outlive it
+  std::shared_ptr<FrameArena> arena;
+  std::shared_ptr<FrameViews> frame;
   std::chrono::time_point<std::chrono::system_clock> timestamp;
 
   CapturerOutput() {}
   CapturerOutput(
-      const cv::Mat& _frame,
+      const std::shared_ptr<FrameArena>& _arena,
+      const std::shared_ptr<FrameViews>& _frame,
       const std::chrono::time_point<std::chrono::system_clock>& _timestamp)
-      : frame(_frame), timestamp(_timestamp) {}
+      : arena(_arena), frame(_frame), timestamp(_timestamp) {}
   CapturerOutput(
-      cv::Mat&& _frame,
+      std::shared_ptr<FrameArena>&& _arena,
+      std::shared_ptr<FrameViews>&& _frame,
       std::chrono::time_point<std::chrono::system_clock>&& _timestamp)
-      : frame(std::move(_frame)), timestamp(std::move(_timestamp)) {}
+      : arena(std::move(_arena)),
+        frame(std::move(_frame)),
+        timestamp(std::move(_timestamp)) {}
 
   CapturerOutput(const CapturerOutput& _other) = default;
 
   CapturerOutput(CapturerOutput&& _other) noexcept
-      : frame(std::move(_other.frame)),
+      : arena(std::move(_other.arena)),
+        frame(std::move(_other.frame)),
         timestamp(std::move(_other.timestamp)) {}
 
   CapturerOutput& operator=(const CapturerOutput& _other) = default;
 
   CapturerOutput& operator=(CapturerOutput&& _other) noexcept {
+    arena = std::move(_other.arena);
     frame = std::move(_other.frame);
     timestamp = std::move(_other.timestamp);
 
@@ -46,9 +61,19 @@ class Capturer {
   explicit Capturer(std::string _source, int _settedFrameWidth,
                     int _settedFrameHeight, std::string _settedCodec,
                     int _settedFps, cv::Rect2d _roi, int _framesDelayMs,
-                    std::string _origFrameName, int _timeoutMs);
+                    std::string _origFrameName, size_t _frameArenaSize,
+                    bool _rawMjpeg, bool _liveMode, int _v4l2Buffers,
+                    int _timeoutMs);
 
+  // In live mode pop() asks for a frame and waits for the next grab, it
+  // returns one newest frame
   std::list<CapturerOutput> pop();
+  bool isLive() const { return mLiveMode; }
+
+  // Optional, must be set before doWork()
+  void setClipRecorder(const std::shared_ptr<ClipRecorder> &_recorder) {
+    mClipRecorder = _recorder;
+  }
 
   void doWork();
 
@@ -60,14 +85,39 @@ class Capturer {
   cv::Rect2d mRoi;
   int mFramesDelayMs;
   std::string mOrigFrameName;
+  // Source gives compressed MJPEG frames, they are decoded here
+  bool mRawMjpeg;
+  // Live source: doWork() grabs every frame, so that backend buffers do not
+  // fill, but retrieves and decodes only frames asked by pop(). Raw MJPEG
+  // frames are retrieved for clips anyway, it costs only a copy.
+  bool mLiveMode;
+  // Linux device is read by V4l2Device with this number of buffers instead of
+  // cv::VideoCapture, if it is positive. Its frames are not copied and get
+  // driver timestamps.
+  int mV4l2Buffers;
   int mTimeoutMs;
   std::chrono::time_point<std::chrono::system_clock> mPrevFrameTs;
   bool mMustDoOrig;
   cv::VideoCapture mCvCapture;
+  std::shared_ptr<V4l2Device> mDevice;
+  std::shared_ptr<FrameArenaPool> mArenaPool;
+  std::shared_ptr<ClipRecorder> mClipRecorder;
 
   std::list<CapturerOutput> mOutputData;
+  bool mRequested;  // Live mode, pop() waits for a frame
+  long mGrabbed, mRetrieved;
   std::mutex mOutputMutex;
   std::condition_variable mHaveOutput;
+
+  void openCapture();
+  void reopenCapture();
+  void readDevice();
+  // Gives frame to clip recorder and pipeline. _frame is empty if frame is
+  // compressed, _lease keeps its memory.
+  void pushFrame(const cv::Mat &_frame, JpegBuffer _jpeg,
+                 const cv::Size &_imageSize,
+                 const std::chrono::time_point<std::chrono::system_clock> &_ts,
+                 const std::shared_ptr<void> &_lease);
 };
 
 #endif  // CAPTURER_H
@@ -49,6 +49,19 @@ shared_ptr<Capturer> CapturerFactory::createCapturer(
       _config.contains("origFrameName") && _config["origFrameName"].is_string()
           ? _config["origFrameName"].get<string>()
           : "",
+      _config.contains("frameArenaSize") &&
+              _config["frameArenaSize"].is_number()
+          ? _config["frameArenaSize"].get<size_t>()
+          : 64 * 1024,
+      _config.contains("rawMjpeg") && _config["rawMjpeg"].is_boolean()
+          ? _config["rawMjpeg"].get<bool>()
+          : false,
+      _config.contains("liveMode") && _config["liveMode"].is_boolean()
+          ? _config["liveMode"].get<bool>()
+          : false,
+      _config.contains("v4l2Buffers") && _config["v4l2Buffers"].is_number()
+          ? _config["v4l2Buffers"].get<int>()
+          : 0,
       _config.contains("waitTimeoutMs") && _config["waitTimeoutMs"].is_number()
           ? _config["waitTimeoutMs"].get<int>()
           : 200));
@@ -0,0 +1,216 @@
+#include "cliprecorder.h"
+
+#include <boost/log/trivial.hpp>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+#include <opencv2/imgcodecs.hpp>
+
+using namespace cv;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+// Decoded images waiting for encoding, the older ones are dropped
+const size_t maxImages = 4;
+
+}  // namespace
+
+ClipRecorder::ClipRecorder(const string &_dir, int _preEventMs,
+                           int _postEventMs, int _latencyMs,
+                           size_t _maxBufferBytes, bool _encodeDecoded,
+                           int _jpegQuality, int _timeoutMs)
+    : mDir(_dir),
+      mPreEvent(_preEventMs),
+      mPostEvent(_postEventMs),
+      mLatency(std::max(_latencyMs, 0)),
+      mMaxBufferBytes(_maxBufferBytes),
+      mEncodeDecoded(_encodeDecoded),
+      mEncodeParams({IMWRITE_JPEG_QUALITY, _jpegQuality}),
+      mTimeoutMs(_timeoutMs),
+      mDroppedImages(0),
+      mBufferBytes(0),
+      mEvicted(0),
+      mFile(nullptr) {}
+
+ClipRecorder::~ClipRecorder() {
+  if (mFile) fclose(mFile);
+}
+
+void ClipRecorder::pushFrame(const time_point<system_clock> &_timestamp,
+                             const JpegBuffer &_jpeg) {
+  unique_lock<mutex> lck(mMutex);
+
+  addFrame(_timestamp, _jpeg);
+
+  if (!mClips.empty()) mHaveWork.notify_all();
+}
+
+void ClipRecorder::pushImage(const time_point<system_clock> &_timestamp,
+                             const Mat &_image) {
+  unique_lock<mutex> lck(mMutex);
+
+  if (mImages.size() >= maxImages) {
+    mImages.pop_front();
+    ++mDroppedImages;
+  }
+
+  mImages.push_back(Image{_timestamp, _image});
+
+  mHaveWork.notify_all();
+}
+
+void ClipRecorder::addFrame(const time_point<system_clock> &_timestamp,
+                            const JpegBuffer &_jpeg) {
+  mFrames.push_back(Frame{_timestamp, _jpeg});
+  mBufferBytes += _jpeg->size();
+
+  // Frames, which may be needed by a clip, are kept for pre and post event
+  // time, so the recorder thread may be late for post event time, and for
+  // latency of events, which come through the pipeline
+  while (!mFrames.empty() &&
+         (mBufferBytes > mMaxBufferBytes ||
+          mFrames.front().timestamp <
+              _timestamp - mPreEvent - mPostEvent - mLatency)) {
+    if (!mClips.empty() && mFrames.front().timestamp >= mClips.front().begin &&
+        mFrames.front().timestamp > mWritten)
+      ++mEvicted;
+
+    mBufferBytes -= mFrames.front().jpeg->size();
+    mFrames.pop_front();
+  }
+}
+
+void ClipRecorder::encodeImages() {
+  {
+    unique_lock<mutex> lck(mMutex);
+
+    mToEncode.assign(make_move_iterator(mImages.begin()),
+                     make_move_iterator(mImages.end()));
+    mImages.clear();
+
+    if (mDroppedImages > 0) {
+      BOOST_LOG_TRIVIAL(warning) << "ClipRecorder: " << mDroppedImages
+                                 << " frames were dropped before encoding";
+      mDroppedImages = 0;
+    }
+  }
+
+  if (mToEncode.empty()) return;
+
+  vector<JpegBuffer> encoded;
+  encoded.reserve(mToEncode.size());
+
+  for (const auto &i : mToEncode) {
+    auto buf = make_shared<vector<unsigned char>>();
+
+    if (imencode(".jpg", i.bgr, *buf, mEncodeParams))
+      encoded.push_back(buf);
+    else
+      encoded.push_back(nullptr);
+  }
+
+  unique_lock<mutex> lck(mMutex);
+
+  for (size_t i = 0; i < mToEncode.size(); ++i)
+    if (encoded[i]) addFrame(mToEncode[i].timestamp, encoded[i]);
+
+  mToEncode.clear();
+}
+
+void ClipRecorder::pushEvents(const list<CrossEvent> &_events) {
+  unique_lock<mutex> lck(mMutex);
+
+  for (const auto &e : _events) {
+    Clip clip{e.timestamp - mPreEvent, e.timestamp + mPostEvent};
+
+    // Events come in time order, so only the last clip may overlap
+    if (!mClips.empty() && clip.begin <= mClips.back().end)
+      mClips.back().end = max(mClips.back().end, clip.end);
+    else
+      mClips.push_back(clip);
+  }
+
+  mHaveWork.notify_all();
+}
+
+void ClipRecorder::doWork() {
+  Clip clip;
+  bool finished = false;
+  time_point<system_clock> written;
+
+  {
+    unique_lock<mutex> lck(mMutex);
+
+    if (mImages.empty() && (mClips.empty() || mFrames.empty() ||
+                            mFrames.back().timestamp <= mWritten))
+      mHaveWork.wait_for(lck, milliseconds(mTimeoutMs));
+  }
+
+  // Before clips, so that they get the new frames
+  encodeImages();
+
+  {
+    unique_lock<mutex> lck(mMutex);
+
+    if (mClips.empty()) return;
+
+    clip = mClips.front();
+
+    // Frames of the clip, which are not written yet; buffers are shared,
+    // so this is cheap
+    mToWrite.clear();
+    for (const auto &f : mFrames)
+      if (f.timestamp >= clip.begin && f.timestamp <= clip.end &&
+          f.timestamp > mWritten)
+        mToWrite.push_back(f);
+
+    written = mWritten;
+    finished = !mFrames.empty() && mFrames.back().timestamp >= clip.end;
+    if (finished) mClips.pop_front();
+
+    if (mEvicted > 0) {
+      BOOST_LOG_TRIVIAL(warning) << "ClipRecorder: " << mEvicted
+                                 << " frames were evicted before writing";
+      mEvicted = 0;
+    }
+  }
+
+  if (!mFile && !mToWrite.empty()) {
+    time_t t = system_clock::to_time_t(clip.begin);
+    auto local = *localtime(&t);
+    char name[64];
+    strftime(name, sizeof(name), "clip_%Y%m%d_%H%M%S.mjpeg", &local);
+
+    mFileName = mDir.empty() ? name : mDir + "/" + name;
+    mFile = fopen(mFileName.c_str(), "wb");
+
+    if (!mFile)
+      BOOST_LOG_TRIVIAL(error) << "ClipRecorder: can not open " << mFileName
+                               << ": " << strerror(errno);
+  }
+
+  for (const auto &f : mToWrite) {
+    if (mFile) fwrite(f.jpeg->data(), 1, f.jpeg->size(), mFile);
+    written = f.timestamp;
+  }
+  mToWrite.clear();
+
+  if (finished) {
+    if (mFile) {
+      fclose(mFile);
+      mFile = nullptr;
+
+      BOOST_LOG_TRIVIAL(info) << "ClipRecorder: clip " << mFileName
+                              << " has been written";
+    }
+
+    // Clip may have no frames at all, next one starts after it anyway
+    written = max(written, clip.end);
+  }
+
+  unique_lock<mutex> lck(mMutex);
+  mWritten = written;
+}
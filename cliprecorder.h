@@ -0,0 +1,100 @@
+#ifndef CLIPRECORDER_H
+#define CLIPRECORDER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+
+#include "crosscounter.h"
+#include "jpegdecoder.h"
+
+// Writes clips around counting events from a ring of JPEG frames, without
+// decoding or re-encoding them. Events reach the recorder _latencyMs after
+// their frames at most, so the ring keeps frames of the last _preEventMs +
+// _postEventMs + _latencyMs, but not more than _maxBufferBytes in total.
+// Clip of an event covers [event - _preEventMs, event + _postEventMs],
+// overlapping clips are merged into one. Clips are written as MJPEG streams
+// (concatenated JPEG images) in the recorder thread while they grow.
+//
+// Sources, which give decoded frames, need JPEG encoding for clips. It is
+// done only if _encodeDecoded is set, in the recorder thread, with
+// _jpegQuality.
+class ClipRecorder {
+ public:
+  explicit ClipRecorder(const std::string &_dir, int _preEventMs,
+                        int _postEventMs, int _latencyMs,
+                        size_t _maxBufferBytes, bool _encodeDecoded,
+                        int _jpegQuality, int _timeoutMs);
+  virtual ~ClipRecorder();
+
+  bool encodesDecoded() const { return mEncodeDecoded; }
+
+  // Capturer thread
+  void pushFrame(
+      const std::chrono::time_point<std::chrono::system_clock> &_timestamp,
+      const JpegBuffer &_jpeg);
+  // Capturer thread, _image is encoded later by the recorder thread, so it
+  // must not be modified after pushing. If the recorder is late, the oldest
+  // waiting images are dropped.
+  void pushImage(
+      const std::chrono::time_point<std::chrono::system_clock> &_timestamp,
+      const cv::Mat &_image);
+  void pushEvents(const std::list<CrossEvent> &_events);
+
+  void doWork();
+
+ protected:
+  struct Frame {
+    std::chrono::time_point<std::chrono::system_clock> timestamp;
+    JpegBuffer jpeg;
+  };
+
+  struct Image {
+    std::chrono::time_point<std::chrono::system_clock> timestamp;
+    cv::Mat bgr;
+  };
+
+  struct Clip {
+    std::chrono::time_point<std::chrono::system_clock> begin, end;
+  };
+
+  std::string mDir;
+  std::chrono::milliseconds mPreEvent, mPostEvent, mLatency;
+  size_t mMaxBufferBytes;
+  bool mEncodeDecoded;
+  std::vector<int> mEncodeParams;
+  int mTimeoutMs;
+
+  std::deque<Image> mImages;  // Waiting for encoding, the oldest first
+  long mDroppedImages;
+
+  std::deque<Frame> mFrames;  // Ring, the oldest first
+  size_t mBufferBytes;
+  std::list<Clip> mClips;  // Not finished clips, ordered by time
+  // Time of the last written frame
+  std::chrono::time_point<std::chrono::system_clock> mWritten;
+  long mEvicted;  // Frames evicted by size limit before they were written
+  std::mutex mMutex;
+  std::condition_variable mHaveWork;
+
+  // Used by recorder thread only
+  FILE *mFile;
+  std::string mFileName;
+  std::vector<Frame> mToWrite;
+  std::vector<Image> mToEncode;
+
+  // mMutex must be locked
+  void addFrame(
+      const std::chrono::time_point<std::chrono::system_clock> &_timestamp,
+      const JpegBuffer &_jpeg);
+  void encodeImages();
+};
+
+#endif  // CLIPRECORDER_H
@@ -0,0 +1,40 @@
+#include "cliprecorderfactory.h"
+
+using namespace std;
+using namespace nlohmann;
+
+shared_ptr<ClipRecorder> ClipRecorderFactory::createClipRecorder(
+    const json &_config) {
+  bool on = _config.contains("on") && _config["on"].is_boolean()
+                ? _config["on"].get<bool>()
+                : false;
+
+  if (!on) return nullptr;
+
+  return shared_ptr<ClipRecorder>(new ClipRecorder(
+      _config.contains("dir") && _config["dir"].is_string()
+          ? _config["dir"].get<string>()
+          : "",
+      _config.contains("preEventMs") && _config["preEventMs"].is_number()
+          ? _config["preEventMs"].get<int>()
+          : 3000,
+      _config.contains("postEventMs") && _config["postEventMs"].is_number()
+          ? _config["postEventMs"].get<int>()
+          : 3000,
+      _config.contains("latencyMs") && _config["latencyMs"].is_number()
+          ? _config["latencyMs"].get<int>()
+          : 2000,
+      _config.contains("maxBufferBytes") &&
+              _config["maxBufferBytes"].is_number()
+          ? _config["maxBufferBytes"].get<size_t>()
+          : 32 * 1024 * 1024,
+      _config.contains("encodeDecoded") && _config["encodeDecoded"].is_boolean()
+          ? _config["encodeDecoded"].get<bool>()
+          : false,
+      _config.contains("jpegQuality") && _config["jpegQuality"].is_number()
+          ? _config["jpegQuality"].get<int>()
+          : 80,
+      _config.contains("waitTimeoutMs") && _config["waitTimeoutMs"].is_number()
+          ? _config["waitTimeoutMs"].get<int>()
+          : 200));
+}
@@ -0,0 +1,20 @@
+#ifndef CLIPRECORDERFACTORY_H
+#define CLIPRECORDERFACTORY_H
+
+#include <memory>
+#include <nlohmann/json.hpp>
+
+#include "cliprecorder.h"
+
+class ClipRecorderFactory {
+ public:
+  virtual ~ClipRecorderFactory() {}
+
+  static std::shared_ptr<ClipRecorder> createClipRecorder(
+      const nlohmann::json &_config);
+
+ private:
+  explicit ClipRecorderFactory() {}
+};
+
+#endif  // CLIPRECORDERFACTORY_H
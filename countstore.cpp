@@ -0,0 +1,277 @@
+#include "countstore.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <cerrno>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+const char magic[8] = {'C', 'O', 'C', 'O', 'U', 'N', 'T', '1'};
+
+// File header: magic, block rows:u32, used blocks:u32
+const size_t headerSize = 64;
+const size_t blockRowsOffset = 8;
+const size_t blocksOffset = 12;
+
+// Block header: base minute:i64, rows:u32, max delta:u16, padding:u16.
+// Columns follow it in order of alignment.
+const size_t blockHeaderSize = 16;
+const size_t rowSize = 4 + 2 + 2 + 2 + 1 + 1 + 1;
+
+const uint32_t maxDelta = 0xffff;
+
+// The file grows by this number of blocks
+const uint32_t growBlocks = 16;
+
+struct BlockColumns {
+  int64_t *baseMinute;
+  uint32_t *rows;
+  uint16_t *maxDelta;
+  uint32_t *count;
+  uint16_t *delta;
+  uint16_t *id;
+  int16_t *itemClass;
+  uint8_t *kind;
+  int8_t *xdir, *ydir;
+
+  BlockColumns(char *_block, uint32_t _blockRows) {
+    baseMinute = reinterpret_cast<int64_t *>(_block);
+    rows = reinterpret_cast<uint32_t *>(_block + 8);
+    maxDelta = reinterpret_cast<uint16_t *>(_block + 12);
+
+    char *p = _block + blockHeaderSize;
+    count = reinterpret_cast<uint32_t *>(p);
+    p += 4 * _blockRows;
+    delta = reinterpret_cast<uint16_t *>(p);
+    p += 2 * _blockRows;
+    id = reinterpret_cast<uint16_t *>(p);
+    p += 2 * _blockRows;
+    itemClass = reinterpret_cast<int16_t *>(p);
+    p += 2 * _blockRows;
+    kind = reinterpret_cast<uint8_t *>(p);
+    p += _blockRows;
+    xdir = reinterpret_cast<int8_t *>(p);
+    p += _blockRows;
+    ydir = reinterpret_cast<int8_t *>(p);
+  }
+};
+
+// Value and mask to compare column with, zero mask matches everything
+template <typename T>
+void filterMask(const boost::optional<int> &_value, T &_v, T &_m) {
+  _v = _value ? T(*_value) : T(0);
+  _m = _value ? T(~T(0)) : T(0);
+}
+
+}  // namespace
+
+CountStore::CountStore(const string &_fileName, bool _writable,
+                       uint32_t _blockRows)
+    : mFileName(_fileName),
+      mWritable(_writable),
+      mFd(-1),
+      mData(nullptr),
+      mMappedSize(0),
+      mBlockRows(max<uint32_t>(_blockRows, 64) & ~uint32_t(7)),
+      mBlockSize(0) {
+  mFd = open(mFileName.c_str(), mWritable ? O_RDWR | O_CREAT : O_RDONLY,
+             0644);
+
+  if (mFd < 0) {
+    BOOST_LOG_TRIVIAL(error) << "CountStore: can not open " << mFileName
+                             << ": " << strerror(errno);
+    return;
+  }
+
+  struct stat st;
+  fstat(mFd, &st);
+
+  if (st.st_size == 0) {
+    if (!mWritable) return;
+
+    // New file
+    mBlockSize = blockHeaderSize + rowSize * mBlockRows;
+    if (!map(headerSize + growBlocks * mBlockSize)) return;
+
+    memcpy(mData, magic, sizeof(magic));
+    memcpy(mData + blockRowsOffset, &mBlockRows, sizeof(mBlockRows));
+    return;
+  }
+
+  char header[headerSize];
+  if (pread(mFd, header, headerSize, 0) != ssize_t(headerSize) ||
+      memcmp(header, magic, sizeof(magic)) != 0) {
+    BOOST_LOG_TRIVIAL(error) << "CountStore: " << mFileName
+                             << " is not a count store";
+    return;
+  }
+
+  // Block size of existing file wins
+  memcpy(&mBlockRows, header + blockRowsOffset, sizeof(mBlockRows));
+  mBlockSize = blockHeaderSize + rowSize * mBlockRows;
+
+  map(st.st_size);
+}
+
+CountStore::~CountStore() {
+  if (mData && mWritable) msync(mData, mMappedSize, MS_SYNC);
+  unmap();
+  if (mFd >= 0) close(mFd);
+}
+
+void CountStore::append(int64_t _minute, const CountKey &_key,
+                        uint32_t _count) {
+  if (!mData || !mWritable) return;
+
+  uint32_t *blocks = reinterpret_cast<uint32_t *>(mData + blocksOffset);
+
+  bool newBlock = *blocks == 0;
+  if (!newBlock) {
+    BlockColumns last(block(*blocks - 1), mBlockRows);
+    // Late minutes and long gaps can not be delta encoded in this block
+    newBlock = *last.rows == mBlockRows || _minute < *last.baseMinute ||
+               _minute - *last.baseMinute > maxDelta;
+  }
+
+  if (newBlock) {
+    size_t need = headerSize + (*blocks + 1) * mBlockSize;
+
+    if (need > mMappedSize) {
+      if (!map(headerSize + (*blocks + growBlocks) * mBlockSize)) return;
+      blocks = reinterpret_cast<uint32_t *>(mData + blocksOffset);
+    }
+
+    BlockColumns b(block(*blocks), mBlockRows);
+    *b.baseMinute = _minute;
+    *b.rows = 0;
+    *b.maxDelta = 0;
+    ++*blocks;
+  }
+
+  BlockColumns b(block(*blocks - 1), mBlockRows);
+  uint32_t r = *b.rows;
+  uint16_t delta = uint16_t(_minute - *b.baseMinute);
+
+  b.count[r] = _count;
+  b.delta[r] = delta;
+  b.id[r] = _key.id;
+  b.itemClass[r] = _key.itemClass;
+  b.kind[r] = _key.kind;
+  b.xdir[r] = _key.xdir;
+  b.ydir[r] = _key.ydir;
+  *b.maxDelta = max(*b.maxDelta, delta);
+  // Row becomes visible to readers last
+  *b.rows = r + 1;
+}
+
+void CountStore::sync() {
+  if (mData && mWritable) msync(mData, mMappedSize, MS_ASYNC);
+}
+
+uint64_t CountStore::sum(int64_t _from, int64_t _to,
+                         const CountFilter &_filter, size_t *_scanned) const {
+  if (!mData) return 0;
+
+  uint8_t kind, kindMask;
+  uint8_t xdir, xdirMask, ydir, ydirMask;
+  uint16_t id, idMask, itemClass, itemClassMask;
+  filterMask(_filter.kind, kind, kindMask);
+  filterMask(_filter.xdir, xdir, xdirMask);
+  filterMask(_filter.ydir, ydir, ydirMask);
+  filterMask(_filter.id, id, idMask);
+  filterMask(_filter.itemClass, itemClass, itemClassMask);
+
+  uint32_t blocks;
+  memcpy(&blocks, mData + blocksOffset, sizeof(blocks));
+  // Blocks, which were appended by writer after mapping, are not visible
+  blocks = min<uint64_t>(blocks, (mMappedSize - headerSize) / mBlockSize);
+
+  uint64_t total = 0;
+
+  for (uint32_t i = 0; i < blocks; ++i) {
+    BlockColumns b(block(i), mBlockRows);
+    int64_t base = *b.baseMinute;
+
+    if (base >= _to || base + *b.maxDelta < _from) continue;
+
+    // Minutes range as deltas of the block
+    uint16_t lo = uint16_t(max<int64_t>(_from - base, 0));
+    uint16_t hi = uint16_t(min<int64_t>(_to - 1 - base, *b.maxDelta));
+    uint32_t rows = min(*b.rows, mBlockRows);
+
+    if (_scanned) *_scanned += rows;
+
+    // Branchless, so the compiler vectorizes it
+    uint64_t blockTotal = 0;
+    for (uint32_t r = 0; r < rows; ++r) {
+      uint32_t match =
+          (b.delta[r] >= lo) & (b.delta[r] <= hi) &
+          (((b.kind[r] ^ kind) & kindMask) == 0) &
+          (((uint8_t(b.xdir[r]) ^ xdir) & xdirMask) == 0) &
+          (((uint8_t(b.ydir[r]) ^ ydir) & ydirMask) == 0) &
+          (((b.id[r] ^ id) & idMask) == 0) &
+          (((uint16_t(b.itemClass[r]) ^ itemClass) & itemClassMask) == 0);
+      blockTotal += b.count[r] & (0u - match);
+    }
+
+    total += blockTotal;
+  }
+
+  return total;
+}
+
+size_t CountStore::rows() const {
+  if (!mData) return 0;
+
+  uint32_t blocks;
+  memcpy(&blocks, mData + blocksOffset, sizeof(blocks));
+  blocks = min<uint64_t>(blocks, (mMappedSize - headerSize) / mBlockSize);
+
+  size_t rows = 0;
+  for (uint32_t i = 0; i < blocks; ++i)
+    rows += *BlockColumns(block(i), mBlockRows).rows;
+
+  return rows;
+}
+
+bool CountStore::map(size_t _size) {
+  unmap();
+
+  if (mWritable && ftruncate(mFd, _size) < 0) {
+    BOOST_LOG_TRIVIAL(error) << "CountStore: can not resize " << mFileName
+                             << ": " << strerror(errno);
+    return false;
+  }
+
+  void *p = mmap(nullptr, _size, mWritable ? PROT_READ | PROT_WRITE : PROT_READ,
+                 MAP_SHARED, mFd, 0);
+
+  if (p == MAP_FAILED) {
+    BOOST_LOG_TRIVIAL(error) << "CountStore: can not map " << mFileName
+                             << ": " << strerror(errno);
+    return false;
+  }
+
+  mData = static_cast<char *>(p);
+  mMappedSize = _size;
+
+  return true;
+}
+
+void CountStore::unmap() {
+  if (mData) munmap(mData, mMappedSize);
+  mData = nullptr;
+  mMappedSize = 0;
+}
+
+char *CountStore::block(uint32_t _index) const {
+  return mData + headerSize + _index * mBlockSize;
+}
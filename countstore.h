@@ -0,0 +1,81 @@
+#ifndef COUNTSTORE_H
+#define COUNTSTORE_H
+
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <string>
+
+// What is counted in a bucket
+struct CountKey {
+  uint8_t kind;  // CrossEvent::Type
+  int8_t xdir, ydir;
+  uint16_t id;        // Line or zone number
+  int16_t itemClass;  // -1 if unknown
+
+  CountKey() : kind(0), xdir(0), ydir(0), id(0), itemClass(-1) {}
+  CountKey(uint8_t _kind, int8_t _xdir, int8_t _ydir, uint16_t _id,
+           int16_t _itemClass)
+      : kind(_kind), xdir(_xdir), ydir(_ydir), id(_id), itemClass(_itemClass) {}
+
+  uint64_t packed() const {
+    return uint64_t(kind) << 48 | uint64_t(uint8_t(xdir)) << 40 |
+           uint64_t(uint8_t(ydir)) << 32 | uint64_t(id) << 16 |
+           uint16_t(itemClass);
+  }
+
+  static CountKey unpack(uint64_t _packed) {
+    return CountKey(_packed >> 48, int8_t(_packed >> 40), int8_t(_packed >> 32),
+                    uint16_t(_packed >> 16), int16_t(_packed));
+  }
+};
+
+// Unset fields match everything
+struct CountFilter {
+  boost::optional<int> kind, xdir, ydir, id, itemClass;
+};
+
+// Per-minute counts in a memory mapped columnar file. The file is a
+// sequence of fixed size blocks of _blockRows rows. Every column of a block
+// is a fixed width array, minutes are stored as 16-bit deltas from the
+// first minute of the block, so a row takes 13 bytes. Rows are appended in
+// time order, so queries skip blocks by their minute range and scan
+// columns of the others without branches.
+// One process appends, others may query concurrently.
+class CountStore {
+ public:
+  explicit CountStore(const std::string &_fileName, bool _writable,
+                      uint32_t _blockRows = 4096);
+  virtual ~CountStore();
+
+  CountStore(const CountStore &) = delete;
+  CountStore &operator=(const CountStore &) = delete;
+
+  bool isOpen() const { return mData != nullptr; }
+
+  // _minute is minutes since epoch
+  void append(int64_t _minute, const CountKey &_key, uint32_t _count);
+  // Asynchronous flush of appended rows to the file
+  void sync();
+
+  // Sum of counts in minutes [_from, _to) matching _filter. Rows of blocks,
+  // which are not skipped, are added to *_scanned, if it is given.
+  uint64_t sum(int64_t _from, int64_t _to, const CountFilter &_filter,
+               size_t *_scanned = nullptr) const;
+
+  size_t rows() const;
+
+ private:
+  std::string mFileName;
+  bool mWritable;
+  int mFd;
+  char *mData;
+  size_t mMappedSize;
+  uint32_t mBlockRows;
+  size_t mBlockSize;
+
+  bool map(size_t _size);
+  void unmap();
+  char *block(uint32_t _index) const;
+};
+
+#endif  // COUNTSTORE_H
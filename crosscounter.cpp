@@ -1,10 +1,12 @@
 #include "crosscounter.h"
 
+#include <algorithm>
 #include <boost/log/trivial.hpp>
 #include <cassert>
 #include <chrono>
 
-#include "utilities.h"
+#include "debugrenderer.h"
+#include "thumbnailwriter.h"
 
 using namespace cv;
 using namespace std;
@@ -12,92 +14,81 @@ using namespace std::chrono;
 
 namespace {
 
-// Alg from http://algolist.ru/maths/geom/intersect/lineline2d.php
-bool isLinesCrossInt(const Point2d &l1beg, const Point2d &l1end,
-                     const Point2d &l2beg, const Point2d &l2end) {
-  auto maxx1 = std::max(l1beg.x, l1end.x);
-  auto maxy1 = std::max(l1beg.y, l1end.y);
-  auto minx1 = std::min(l1beg.x, l1end.x);
-  auto miny1 = std::min(l1beg.y, l1end.y);
-  auto maxx2 = std::max(l2beg.x, l2end.x);
-  auto maxy2 = std::max(l2beg.y, l2end.y);
-  auto minx2 = std::min(l2beg.x, l2end.x);
-  auto miny2 = std::min(l2beg.y, l2end.y);
-
-  if (minx1 > maxx2 || maxx1 < minx2 || miny1 > maxy2 || maxy1 < miny2)
-    return false;  // Момент, када линии имеют одну общую вершину...
-
-  auto dx1 = l1end.x - l1beg.x;
-  auto dy1 = l1end.y - l1beg.y;  // Длина проекций первой линии на ось x и y
-  auto dx2 = l2end.x - l2beg.x;
-  auto dy2 = l2end.y - l2beg.y;  // Длина проекций второй линии на ось x и y
-  auto dxx = l1beg.x - l2beg.x;
-  auto dyy = l1beg.y - l2beg.y;
-
-  int div, mul;
-
-  if ((div = (int)((double)dy2 * dx1 - (double)dx2 * dy1)) == 0)
-    return false;  // Линии параллельны...
-  if (div > 0) {
-    if ((mul = (int)((double)dx1 * dyy - (double)dy1 * dxx)) < 0 || mul > div)
-      return false;  // Первый отрезок пересекается за своими границами...
-    if ((mul = (int)((double)dx2 * dyy - (double)dy2 * dxx)) < 0 || mul > div)
-      return false;  // Второй отрезок пересекается за своими границами...
-  }
-
-  if ((mul = -(int)((double)dx1 * dyy - (double)dy1 * dxx)) < 0 || mul > -div)
-    return false;  // Первый отрезок пересекается за своими границами...
-  if ((mul = -(int)((double)dx2 * dyy - (double)dy2 * dxx)) < 0 || mul > -div)
-    return false;  // Второй отрезок пересекается за своими границами...
+// Shot is replaced only by this times better one, so a growing box is not
+// copied on every frame
+const double shotImprovement = 1.1;
 
-  return true;
+int direction(double _from, double _to) {
+  return (_to > _from) - (_to < _from);
 }
 
-bool isLinesCross(const Point2d &l1beg, const Point2d &l1end,
-                  const Point2d &l2beg, const Point2d &l2end) {
-  // TODO: fix it
-  return isLinesCrossInt(l1beg, l1end, l2beg, l2end) ||
-         isLinesCrossInt(l2beg, l2end, l1beg, l1end);
+Point2d center(const Rect2d &_rect) {
+  return Point2d(_rect.x + _rect.width / 2, _rect.y + _rect.height / 2);
 }
 
-void putTextBg(Mat &_frame, const string &_text, const Point &_point,
-               int _fontFace, double _fontScale, const Scalar &_textColor,
-               const Scalar &_bgColor, int _thickness = 1, int _lineType = 8,
-               bool _bottomLeftOrigin = false) {
-  int baseLine;
-  auto textSize =
-      getTextSize(_text, _fontFace, _fontScale, _thickness, &baseLine);
+void mergeMax(vector<int> &_to, const vector<int> &_from) {
+  if (_to.size() < _from.size()) _to.resize(_from.size(), 0);
 
-  int padding = 3;
+  for (size_t i = 0; i < _from.size(); ++i) _to[i] = max(_to[i], _from[i]);
+}
 
-  rectangle(
-      _frame,
-      cv::Rect(_point.x - padding, _point.y - textSize.height - padding,
-               textSize.width + 2 * padding, textSize.height + 3 + 2 * padding),
-      _bgColor, cv::FILLED);
+void applyMax(vector<int> &_to, int _index, int _value) {
+  if (_index < 0) return;
+  if (_to.size() <= size_t(_index)) _to.resize(_index + 1, 0);
 
-  putText(_frame, _text, _point, _fontFace, _fontScale, _textColor, _thickness,
-          _lineType, _bottomLeftOrigin);
+  _to[_index] = max(_to[_index], _value);
 }
 
 }  // namespace
 
-CrossCounter::CrossCounter(bool _debugScreenOutput, const Size &_debugVideoSize,
-                           const vector<pair<Point2d, Point2d>> &_lines,
-                           int _timeoutMs)
-    : mDebugScreenOutput(_debugScreenOutput),
-      mDebugVideoSize(_debugVideoSize),
-      mLines(_lines),
-      mTimeoutMs(_timeoutMs),
-      mCrossCounts(vector<int>(mLines.size(), 0)) {
-  // if (mDebugScreenOutput)
-  //   namedWindow("CrossCounter", WINDOW_AUTOSIZE);
+void CounterState::merge(const CounterState &_other) {
+  mergeMax(lineCrosses, _other.lineCrosses);
+  mergeMax(zoneEntries, _other.zoneEntries);
+  mergeMax(zoneExits, _other.zoneExits);
 }
 
-CrossCounter::~CrossCounter() {
-  if (mDebugScreenOutput) destroyWindow("CrossCounter");
+void CounterState::apply(const CrossEvent &_event) {
+  switch (_event.type) {
+    case CrossEvent::LINE_CROSS:
+      applyMax(lineCrosses, _event.line_id, _event.crosses);
+      break;
+    case CrossEvent::ZONE_ENTER:
+      applyMax(zoneEntries, _event.line_id, _event.crosses);
+      break;
+    case CrossEvent::ZONE_EXIT:
+      applyMax(zoneExits, _event.line_id, _event.crosses);
+      break;
+  }
+}
+
+CrossCounter::CrossCounter(const vector<pair<Point2d, Point2d>> &_lines,
+                           const vector<vector<Point2d>> &_zones,
+                           int _zoneCellSize, int _timeoutMs)
+    : mLines(_lines.size() > maxCountingLines
+                 ? vector<pair<Point2d, Point2d>>(
+                       _lines.begin(), _lines.begin() + maxCountingLines)
+                 : _lines),
+      mLineCrossing(mLines),
+      mZoneMap(_zones, _zoneCellSize),
+      mTimeoutMs(_timeoutMs),
+      mTailLength(1),
+      mCrossCounts(vector<int>(mLines.size(), 0)),
+      mZoneEntries(mZoneMap.zones().size(), 0),
+      mZoneExits(mZoneMap.zones().size(), 0),
+      mZoneOccupancy(mZoneMap.zones().size(), 0) {
+  if (_lines.size() > maxCountingLines)
+    BOOST_LOG_TRIVIAL(error) << "CrossCounter: only " << maxCountingLines
+                             << " of " << _lines.size()
+                             << " lines are counted";
+
+  auto scene = make_shared<CountingScene>();
+  scene->lines = mLines;
+  scene->zones = mZoneMap.zones();
+  mScene = scene;
 }
 
+CrossCounter::~CrossCounter() {}
+
 void CrossCounter::push(const list<TrackerOutput> &_input) {
   unique_lock<mutex> lck(mInputMutex);
 
@@ -127,128 +118,222 @@ void CrossCounter::doWork() {
   }
 
   while (!inputData.empty()) {
-    auto d = inputData.front();
+    auto d = move(inputData.front());
     inputData.pop_front();
 
-    assert(!d.frame.empty());
+    // Archive counting gives no frames, it has no shots and snapshots
+    assert(d.frame || (!mThumbs && !mRenderer));
+
+    auto t0 = chrono::steady_clock::now();
+
+    FrameVector<CrossEvent> ces(d.arena.get());
+
+    mContinued.assign(d.items.size(), 0);
 
-    auto it_track = mCurrentTracks.begin();
-    while (it_track != mCurrentTracks.end()) {
-      auto it_d =
-          find_if(d.items.begin(), d.items.end(), [it_track](const auto &el) {
-            return el.trackId == it_track->trackId;
-          });
+    mItemIndex.reset(d.items.size());
+    for (size_t j = 0; j < d.items.size(); ++j)
+      mItemIndex.insert(d.items[j].trackId, j);
 
-      if (it_d == d.items.end()) {
-        mCurrentTracks.erase(it_track++);  // Kill track
-      } else {
-        it_track->pushTrackedItem(*it_d);  // Append to tail
-        while (it_track->tail.size() > (mDebugScreenOutput ? 30 : 1))
-          it_track->tail.pop_front();
+    // Alive tracks are compacted in place
+    size_t alive = 0;
+    for (size_t i = 0; i < mCurrentTracks.size(); ++i) {
+      auto &t = mCurrentTracks[i];
+      int j = mItemIndex.find(t.trackId);
 
-        d.items.erase(it_d);
-        ++it_track;
+      if (j < 0) {
+        // Kill track, it leaves all zones
+        updateZones(t, 0, center(t.rect), center(t.rect), d.timestamp, ces);
+        if (mThumbs) writeShot(t);
+        continue;
       }
+
+      t.pushTrackedItem(d.items[j]);  // Append to tail
+      mContinued[j] = 1;
+      if (mThumbs) updateShot(t, d.items[j], *d.frame);
+
+      if (alive != i) mCurrentTracks[alive] = move(t);
+      ++alive;
     }
 
-    // New tracks
-    for (const auto &el : d.items) mCurrentTracks.push_back(el);
+    mCurrentTracks.erase(mCurrentTracks.begin() + alive, mCurrentTracks.end());
 
-    std::list<CrossEvent> ces;
+    // New tracks
+    for (size_t i = 0; i < d.items.size(); ++i)
+      if (!mContinued[i]) {
+        mCurrentTracks.push_back(TailedItem(d.items[i], mTailLength));
+        if (mThumbs) updateShot(mCurrentTracks.back(), d.items[i], *d.frame);
+      }
 
     // Cross checking
     assert(mCrossCounts.size() == mLines.size());
-    for (auto it_line = mLines.begin(); it_line != mLines.end(); ++it_line) {
-      for (auto &t : mCurrentTracks)
-        if (t.crosses.find(distance(mLines.begin(), it_line)) ==
-                t.crosses.end() &&
-            !t.tail.empty() &&
-            isLinesCross(t.tail.back().point,
-                         Point2d(t.rect.x + t.rect.width / 2,
-                                 t.rect.y + t.rect.height / 2),
-                         it_line->first, it_line->second)) {
-          t.crosses.insert(distance(mLines.begin(), it_line));
-          ++(mCrossCounts[distance(mLines.begin(), it_line)]);
-
-          {
-            auto p1 = t.tail.back().point;
-            auto p2 = Point2d(t.rect.x + t.rect.width / 2,
-                              t.rect.y + t.rect.height / 2);
-
-            int xdir = 0;
-            if (p2.x > p1.x)
-              xdir = 1;
-            else if (p2.x < p1.x)
-              xdir = -1;
-
-            int ydir = 0;
-            if (p2.y > p1.y)
-              ydir = 1;
-            else if (p2.y < p1.y)
-              ydir = -1;
-
-            ces.push_back(CrossEvent(
-                distance(mLines.begin(), it_line), t.trackId, d.timestamp,
-                mCrossCounts[distance(mLines.begin(), it_line)], xdir, ydir));
-          }
-
-          BOOST_LOG_TRIVIAL(trace)
-              << "Crosses count[" << distance(mLines.begin(), it_line)
-              << "] = " << mCrossCounts[distance(mLines.begin(), it_line)];
-        }
-    }
+    for (auto &t : mCurrentTracks) {
+      auto p2 = center(t.rect);
+      auto p1 = t.tail.empty() ? p2 : t.tail.back().point;
 
-    // Do smth with ces:
-    ces.clear();
-
-    // Optional debug output
-    if (mDebugScreenOutput) {
-      Mat frame = d.frame.clone();
-
-      for (auto it_line = mLines.begin(); it_line != mLines.end(); ++it_line) {
-        line(frame, it_line->first, it_line->second, Scalar(0, 0, 255), 2);
-        putTextBg(
-            frame,
-            "L" + to_string(distance(mLines.begin(), it_line) + 1) + " [" +
-                to_string(mCrossCounts[distance(mLines.begin(), it_line)]) +
-                "]",
-            Point(it_line->first.x + 10, it_line->first.y + 20),
-            FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 0, 255), Scalar(40, 40, 40));
-      }
+      updateZones(t, mZoneMap.lookup(p2), p1, p2, d.timestamp, ces);
 
-      for (const auto &t : mCurrentTracks) {
-        if (t.tail.size() > 1)
-          for (auto it = t.tail.begin(); it != std::prev(t.tail.end()); ++it)
-            line(frame, Point2d(it->point.x, it->point.y),
-                 Point2d(std::next(it)->point.x, std::next(it)->point.y),
-                 /*t.crossed ? Scalar(0, 0, 255) : */ Scalar(255, 0, 0), 1);
-
-        for (auto it = t.tail.begin(); it != t.tail.end(); ++it)
-          rectangle(frame, Rect2d(it->point.x - 2, it->point.y - 2, 5, 5),
-                    /*t.crossed ? Scalar(0, 0, 255) : */
-                    (it->verified ? Scalar(0, 255, 0) : Scalar(255, 0, 0)), 1);
-
-        rectangle(frame, t.rect, /*t.crossed ? Scalar(0, 0, 255) :*/
-                  (t.verified ? Scalar(0, 255, 0) : Scalar(255, 0, 0)), 2);
-
-        putText(frame, "TID = " + to_string(t.trackId),
-                Point(t.rect.x + 10, t.rect.y + 20), FONT_HERSHEY_SIMPLEX, 0.5,
-                /*t.crossed ? Scalar(0, 0, 255) : */
-                (t.verified ? Scalar(0, 255, 0) : Scalar(255, 0, 0)));
-      }
+      if (t.tail.empty()) continue;
+
+      mLineCrossing.find(p1, p2, mCrossedLines);
+
+      for (int l : mCrossedLines) {
+        if (t.crosses.test(l)) continue;
+
+        t.crosses.set(l);
+        ++mCrossCounts[l];
 
-      resize(frame, frame,
-             mDebugVideoSize.empty() ? Size(frame.cols, frame.rows)
-                                     : mDebugVideoSize);
-      putText(frame, timeToStrWithMs(d.timestamp), Point(10, 20),
-              FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0));
+        ces.push_back(CrossEvent(l, t.trackId, d.timestamp, mCrossCounts[l],
+                                 direction(p1.x, p2.x),
+                                 direction(p1.y, p2.y), t.itemClass));
+        if (mThumbs) ces.back().thumbnail = thumbnail(t, d.timestamp);
 
-      {
-        imshow("CrossCounter", frame);
-        waitKey(1);
+        BOOST_LOG_TRIVIAL(trace)
+            << "Crosses count[" << l << "] = " << mCrossCounts[l];
       }
     }
+
+    if (!ces.empty()) {
+      unique_lock<mutex> lck(mOutputMutex);
+
+      mOutputData.insert(mOutputData.end(), ces.begin(), ces.end());
+
+      mHaveOutput.notify_all();
+    }
+
+    BOOST_LOG_TRIVIAL(trace) << "CrossCounter: " << mCurrentTracks.size()
+                             << " tracks checked in "
+                             << chrono::duration_cast<chrono::microseconds>(
+                                    chrono::steady_clock::now() - t0)
+                                    .count()
+                             << " us";
+
+    if (mRenderer && mRenderer->due()) offerSnapshot(d.frame, d.timestamp);
+  }
+}
+
+void CrossCounter::updateZones(
+    TailedItem &_track, uint64_t _zones, const Point2d &_from,
+    const Point2d &_to, const time_point<system_clock> &_timestamp,
+    FrameVector<CrossEvent> &_events) {
+  uint64_t entered = _zones & ~_track.zones;
+  uint64_t exited = _track.zones & ~_zones;
+
+  _track.zones = _zones;
+
+  for (size_t z = 0; z < mZoneOccupancy.size() && (entered | exited); ++z) {
+    uint64_t bit = uint64_t(1) << z;
+
+    if (entered & bit) {
+      ++mZoneOccupancy[z];
+      _events.push_back(CrossEvent(CrossEvent::ZONE_ENTER, z, _track.trackId,
+                                   _timestamp, ++mZoneEntries[z],
+                                   direction(_from.x, _to.x),
+                                   direction(_from.y, _to.y),
+                                   mZoneOccupancy[z], _track.itemClass));
+    } else if (exited & bit) {
+      --mZoneOccupancy[z];
+      _events.push_back(CrossEvent(CrossEvent::ZONE_EXIT, z, _track.trackId,
+                                   _timestamp, ++mZoneExits[z],
+                                   direction(_from.x, _to.x),
+                                   direction(_from.y, _to.y),
+                                   mZoneOccupancy[z], _track.itemClass));
+    } else {
+      continue;
+    }
+
+    if (mThumbs) _events.back().thumbnail = thumbnail(_track, _timestamp);
+
+    entered &= ~bit;
+    exited &= ~bit;
+
+    BOOST_LOG_TRIVIAL(trace) << "Zone occupancy[" << z
+                             << "] = " << mZoneOccupancy[z];
+  }
+}
+
+void CrossCounter::updateShot(TailedItem &_track, const TrackedItem &_item,
+                              FrameViews &_frame) {
+  if (!_item.isRecognized()) return;
+
+  double score = _item.rect.area() * _item.recConfidence;
+  if (score <= _track.shotScore * shotImprovement) return;
+
+  Rect roi = Rect(_item.rect) & Rect(0, 0, _frame.cols(), _frame.rows());
+  if (roi.empty()) return;
+
+  // Only the crop is copied, frame is released with the arena
+  _track.shotScore = score;
+  _track.shot = _frame.bgr()(roi).clone();
+  _track.shotDirty = true;
+}
+
+const string &CrossCounter::thumbnail(
+    TailedItem &_track, const time_point<system_clock> &_timestamp) {
+  // Nothing would be written to the file
+  if (_track.thumbnail.empty() && _track.shot.empty()) return _track.thumbnail;
+
+  if (_track.thumbnail.empty())
+    _track.thumbnail = mThumbs->fileName(_track.trackId, _timestamp);
+
+  writeShot(_track);
+
+  return _track.thumbnail;
+}
+
+void CrossCounter::writeShot(TailedItem &_track) {
+  // Tracks without events have no thumbnail
+  if (_track.thumbnail.empty() || !_track.shotDirty) return;
+
+  mThumbs->push(_track.thumbnail, _track.shot);
+  _track.shotDirty = false;
+}
+
+void CrossCounter::restore(const CounterState &_state) {
+  for (size_t i = 0; i < mCrossCounts.size() && i < _state.lineCrosses.size();
+       ++i)
+    mCrossCounts[i] = _state.lineCrosses[i];
+
+  for (size_t i = 0; i < mZoneEntries.size() && i < _state.zoneEntries.size();
+       ++i)
+    mZoneEntries[i] = _state.zoneEntries[i];
+
+  for (size_t i = 0; i < mZoneExits.size() && i < _state.zoneExits.size(); ++i)
+    mZoneExits[i] = _state.zoneExits[i];
+
+  BOOST_LOG_TRIVIAL(info) << "CrossCounter: counters restored for "
+                          << _state.lineCrosses.size() << " lines and "
+                          << _state.zoneEntries.size() << " zones";
+}
+
+void CrossCounter::setDebugRenderer(
+    const shared_ptr<DebugRenderer> &_renderer) {
+  mRenderer = _renderer;
+  // Tails are kept for drawing only
+  mTailLength = mRenderer ? mRenderer->tailLength() : 1;
+}
+
+void CrossCounter::offerSnapshot(const shared_ptr<FrameViews> &_frame,
+                                 const time_point<system_clock> &_timestamp) {
+  RenderSnapshot snapshot;
+  snapshot.frame = _frame;
+  snapshot.timestamp = _timestamp;
+  snapshot.scene = mScene;
+  snapshot.lineCounts = mCrossCounts;
+  snapshot.zoneOccupancy = mZoneOccupancy;
+  snapshot.zoneEntries = mZoneEntries;
+
+  snapshot.tracks.resize(mCurrentTracks.size());
+  for (size_t i = 0; i < mCurrentTracks.size(); ++i) {
+    const auto &t = mCurrentTracks[i];
+    auto &r = snapshot.tracks[i];
+
+    r.trackId = t.trackId;
+    r.rect = t.rect;
+    r.verified = t.verified;
+    r.tail.assign(t.tail.begin(), t.tail.end());
   }
+
+  mRenderer->offer(move(snapshot));
 }
 
 list<CrossEvent> CrossCounter::pop() {
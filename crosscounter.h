@@ -1,17 +1,29 @@
 #ifndef CROSSCOUNTER_H
 #define CROSSCOUNTER_H
 
+#include <bitset>
+#include <boost/circular_buffer.hpp>
 #include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <list>
 #include <memory>
 #include <mutex>
-#include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "linecrossing.h"
+#include "trackindex.h"
 #include "tracker.h"
+#include "zonemap.h"
+
+class DebugRenderer;
+struct CountingScene;
+class ThumbnailWriter;
+
+// Lines beyond this number are ignored
+const size_t maxCountingLines = 256;
 
 struct VerifiedPoint {
   cv::Point2d point;
@@ -24,12 +36,26 @@ struct VerifiedPoint {
 
 struct TailedItem {
   int trackId;
-  std::list<VerifiedPoint> tail;  // Without last position.
-  cv::Rect2d rect;                // Last position
-  bool verified;                  // Last position verified
-  std::set<int> crosses;  // lines numbers, which this TailedItem crossed
-
-  TailedItem() : trackId(-1), verified(false) {}
+  // Without last position. Fixed capacity, the oldest points are overwritten.
+  boost::circular_buffer<VerifiedPoint> tail;
+  cv::Rect2d rect;  // Last position
+  bool verified;    // Last position verified
+  std::bitset<maxCountingLines> crosses;  // Lines, this TailedItem crossed
+  uint64_t zones;  // Zones, this TailedItem is inside of now
+  int itemClass;   // Last recognized type, -1 if was not recognized
+  // Best shot, kept only if thumbnails are written
+  double shotScore;       // Area x confidence of shot
+  cv::Mat shot;           // Crop of frame, not modified after assignment
+  bool shotDirty;         // Shot is not written yet
+  std::string thumbnail;  // File of shot, assigned with the first event
+
+  TailedItem()
+      : trackId(-1),
+        verified(false),
+        zones(0),
+        itemClass(-1),
+        shotScore(0.0),
+        shotDirty(false) {}
 
   // TailedItem -> TailedItem
 
@@ -42,46 +68,54 @@ struct TailedItem {
         tail(std::move(_other.tail)),
         rect(std::move(_other.rect)),
         verified(std::exchange(_other.verified, false)),
-        crosses(std::move(_other.crosses)) {}
+        crosses(_other.crosses),
+        zones(std::exchange(_other.zones, 0)),
+        itemClass(std::exchange(_other.itemClass, -1)),
+        shotScore(std::exchange(_other.shotScore, 0.0)),
+        shot(std::move(_other.shot)),
+        shotDirty(std::exchange(_other.shotDirty, false)),
+        thumbnail(std::move(_other.thumbnail)) {}
 
   TailedItem &operator=(TailedItem &&_other) noexcept {
     trackId = std::exchange(_other.trackId, -1);
     tail = std::move(_other.tail);
     rect = std::move(_other.rect);
     verified = std::exchange(_other.verified, false);
-    crosses = std::move(_other.crosses);
+    crosses = _other.crosses;
+    zones = std::exchange(_other.zones, 0);
+    itemClass = std::exchange(_other.itemClass, -1);
+    shotScore = std::exchange(_other.shotScore, 0.0);
+    shot = std::move(_other.shot);
+    shotDirty = std::exchange(_other.shotDirty, false);
+    thumbnail = std::move(_other.thumbnail);
 
     return *this;
   }
 
   // TrackedItem -> TailedItem
 
-  TailedItem(const TrackedItem &_other)
+  TailedItem(const TrackedItem &_other, size_t _tailLength)
       : trackId(_other.trackId),
+        tail(_tailLength),
         rect(_other.rect),
-        verified(_other.recType && _other.recConfidence) {}
+        verified(_other.isRecognized()),
+        zones(0),
+        itemClass(_other.isRecognized() ? _other.recType : -1),
+        shotScore(0.0),
+        shotDirty(false) {}
 
   TailedItem &operator=(const TrackedItem &_other) {
     trackId = _other.trackId;
     rect = _other.rect;
-    verified = _other.recType && _other.recConfidence;
+    verified = _other.isRecognized();
     tail.clear();
-    crosses.clear();
-
-    return *this;
-  }
-
-  TailedItem(TrackedItem &&_trackedItem)
-      : trackId(std::exchange(_trackedItem.trackId, -1)),
-        rect(std::move(_trackedItem.rect)),
-        verified(_trackedItem.recType && _trackedItem.recConfidence) {}
-
-  TailedItem &operator=(TrackedItem &&_trackedItem) {
-    trackId = std::exchange(_trackedItem.trackId, -1);
-    rect = std::move(_trackedItem.rect);
-    verified = _trackedItem.recType && _trackedItem.recConfidence;
-    tail.clear();
-    crosses.clear();
+    crosses.reset();
+    zones = 0;
+    itemClass = _other.isRecognized() ? _other.recType : -1;
+    shotScore = 0.0;
+    shot.release();
+    shotDirty = false;
+    thumbnail.clear();
 
     return *this;
   }
@@ -96,50 +130,79 @@ struct TailedItem {
         cv::Point2d(rect.x + rect.width / 2, rect.y + rect.height / 2),
         verified));
     rect = _trackedItem.rect;
-    verified = _trackedItem.recType && _trackedItem.recConfidence;
-  }
-
-  void pushTrackedItem(TrackedItem &&_trackedItem) {
-    assert(trackId == _trackedItem.trackId);
-    assert(!rect.empty() && !_trackedItem.rect.empty());
-
-    tail.push_back(VerifiedPoint(
-        cv::Point2d(rect.x + rect.width / 2, rect.y + rect.height / 2),
-        verified));
-    rect = std::move(_trackedItem.rect);
-    verified = _trackedItem.recType && _trackedItem.recConfidence;
+    verified = _trackedItem.isRecognized();
+    if (verified) itemClass = _trackedItem.recType;
   }
 };
 
 struct CrossEvent {
-  int line_id, track_id;
+  enum Type { LINE_CROSS, ZONE_ENTER, ZONE_EXIT };
+
+  Type type;
+  int line_id, track_id;  // line_id is zone number for zone events
   std::chrono::time_point<std::chrono::system_clock> timestamp;
-  int crosses;
+  int crosses;  // For zones, how many times the zone was entered or exited
   int xdir, ydir;  // -1, 0 or 1
+  int occupancy;   // Tracks inside of the zone after zone event
+  int item_class;  // Recognized type of track, -1 if unknown
+  // Best shot file of track, empty if thumbnails are not written. The file
+  // appears when the shot is encoded, it is replaced by a better shot when
+  // the track ends.
+  std::string thumbnail;
 
   CrossEvent()
-      : line_id(-1),
+      : type(LINE_CROSS),
+        line_id(-1),
         track_id(-1),
         timestamp(std::chrono::system_clock::now()),
         crosses(0),
         xdir(0),
-        ydir(0) {}
+        ydir(0),
+        occupancy(0),
+        item_class(-1) {}
   CrossEvent(int _line_id, int _track_id,
              std::chrono::time_point<std::chrono::system_clock> _timestamp,
-             int _crosses, int _xdir, int _ydir)
-      : line_id(_line_id),
+             int _crosses, int _xdir, int _ydir, int _item_class = -1)
+      : type(LINE_CROSS),
+        line_id(_line_id),
+        track_id(_track_id),
+        timestamp(_timestamp),
+        crosses(_crosses),
+        xdir(_xdir),
+        ydir(_ydir),
+        occupancy(0),
+        item_class(_item_class) {}
+  CrossEvent(Type _type, int _zone_id, int _track_id,
+             std::chrono::time_point<std::chrono::system_clock> _timestamp,
+             int _crosses, int _xdir, int _ydir, int _occupancy,
+             int _item_class = -1)
+      : type(_type),
+        line_id(_zone_id),
         track_id(_track_id),
         timestamp(_timestamp),
         crosses(_crosses),
         xdir(_xdir),
-        ydir(_ydir) {}
+        ydir(_ydir),
+        occupancy(_occupancy),
+        item_class(_item_class) {}
+};
+
+// Running totals of counters, which may be saved and restored
+struct CounterState {
+  std::vector<int> lineCrosses;
+  std::vector<int> zoneEntries, zoneExits;
+
+  // Takes greater value of every counter, totals only grow
+  void merge(const CounterState &_other);
+  // Accounts event, which carries the total of its counter
+  void apply(const CrossEvent &_event);
 };
 
 class CrossCounter {
  public:
   explicit CrossCounter(
-      bool _debugScreenOutput, const cv::Size &_debugVideoSize,
       const std::vector<std::pair<cv::Point2d, cv::Point2d>> &_lines,
+      const std::vector<std::vector<cv::Point2d>> &_zones, int _zoneCellSize,
       int _timeoutMs);
   virtual ~CrossCounter();
 
@@ -150,22 +213,59 @@ class CrossCounter {
 
   std::list<CrossEvent> pop();
 
+  // Continues counting from saved totals, must be called before doWork().
+  // Zone occupancy is not restored, tracks are lost with the process.
+  void restore(const CounterState &_state);
+
+  // Optional, must be set before doWork()
+  void setDebugRenderer(const std::shared_ptr<DebugRenderer> &_renderer);
+  void setThumbnailWriter(const std::shared_ptr<ThumbnailWriter> &_thumbs) {
+    mThumbs = _thumbs;
+  }
+
  protected:
-  bool mDebugScreenOutput;
-  cv::Size mDebugVideoSize;
   std::vector<std::pair<cv::Point2d, cv::Point2d>> mLines;
+  LineCrossing mLineCrossing;
+  ZoneMap mZoneMap;
   int mTimeoutMs;
+  std::shared_ptr<const CountingScene> mScene;
+  std::shared_ptr<DebugRenderer> mRenderer;
+  std::shared_ptr<ThumbnailWriter> mThumbs;
 
   std::list<TrackerOutput> mInputData;
   std::mutex mInputMutex;
   std::condition_variable mHaveInput;
 
-  std::list<TailedItem> mCurrentTracks;
+  size_t mTailLength;
+  std::vector<TailedItem> mCurrentTracks;
+  std::vector<char> mContinued;  // Items of frame, which continue some track
+  TrackIndex mItemIndex;         // Items of frame by track id
+  std::vector<int> mCrossedLines;
   std::vector<int> mCrossCounts;
+  std::vector<int> mZoneEntries, mZoneExits, mZoneOccupancy;
 
   std::list<CrossEvent> mOutputData;
   std::mutex mOutputMutex;
   std::condition_variable mHaveOutput;
+
+  // Emits entry and exit events of track, which is inside of _zones now
+  void updateZones(
+      TailedItem &_track, uint64_t _zones, const cv::Point2d &_from,
+      const cv::Point2d &_to,
+      const std::chrono::time_point<std::chrono::system_clock> &_timestamp,
+      FrameVector<CrossEvent> &_events);
+  // Keeps crop of _frame, if _item is a better shot of _track
+  void updateShot(TailedItem &_track, const TrackedItem &_item,
+                  FrameViews &_frame);
+  // Thumbnail file of _track, which has an event; current shot is written.
+  // Empty while the track has no shot, a later event may get the file.
+  const std::string &thumbnail(
+      TailedItem &_track,
+      const std::chrono::time_point<std::chrono::system_clock> &_timestamp);
+  void writeShot(TailedItem &_track);
+  void offerSnapshot(
+      const std::shared_ptr<FrameViews> &_frame,
+      const std::chrono::time_point<std::chrono::system_clock> &_timestamp);
 };
 
 #endif  // CROSSCOUNTER_H
@@ -27,21 +27,27 @@ shared_ptr<CrossCounter> CrossCounterFactory::createCrossCounter(
             Point2d((*it)["begX"].get<double>(), (*it)["begY"].get<double>()),
             Point2d((*it)["endX"].get<double>(), (*it)["endY"].get<double>())));
 
-  Size debugVideoSize;
+  vector<vector<Point2d>> zones;
 
-  if (_config.contains("debugVideoWidth") &&
-      _config["debugVideoWidth"].is_number() &&
-      _config.contains("debugVideoHeight") &&
-      _config["debugVideoHeight"].is_number())
-    debugVideoSize = Size(_config["debugVideoWidth"].get<int>(),
-                          _config["debugVideoHeight"].get<int>());
+  if (_config.contains("zones") && _config["zones"].is_array())
+    for (json::const_iterator it = _config["zones"].begin();
+         it != _config["zones"].end(); ++it)
+      if (it->contains("points") && (*it)["points"].is_array()) {
+        vector<Point2d> zone;
+
+        for (const auto &p : (*it)["points"])
+          if (p.contains("x") && p["x"].is_number() && p.contains("y") &&
+              p["y"].is_number())
+            zone.push_back(Point2d(p["x"].get<double>(), p["y"].get<double>()));
+
+        zones.push_back(zone);
+      }
 
   return shared_ptr<CrossCounter>(new CrossCounter(
-      _config.contains("debugScreenOutput") &&
-              _config["debugScreenOutput"].is_boolean()
-          ? _config["debugScreenOutput"].get<bool>()
-          : false,
-      debugVideoSize, lines,
+      lines, zones,
+      _config.contains("zoneCellSize") && _config["zoneCellSize"].is_number()
+          ? _config["zoneCellSize"].get<int>()
+          : 4,
       _config.contains("waitTimeoutMs") && _config["waitTimeoutMs"].is_number()
           ? _config["waitTimeoutMs"].get<int>()
           : 200));
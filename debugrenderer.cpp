@@ -0,0 +1,185 @@
+#include "debugrenderer.h"
+
+#include <boost/log/trivial.hpp>
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "utilities.h"
+
+using namespace cv;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+// Statistics are logged every this number of rendered frames
+const long statisticsPeriod = 1000;
+
+void putTextBg(Mat &_frame, const string &_text, const Point &_point,
+               int _fontFace, double _fontScale, const Scalar &_textColor,
+               const Scalar &_bgColor, int _thickness = 1, int _lineType = 8,
+               bool _bottomLeftOrigin = false) {
+  int baseLine;
+  auto textSize =
+      getTextSize(_text, _fontFace, _fontScale, _thickness, &baseLine);
+
+  int padding = 3;
+
+  rectangle(
+      _frame,
+      cv::Rect(_point.x - padding, _point.y - textSize.height - padding,
+               textSize.width + 2 * padding, textSize.height + 3 + 2 * padding),
+      _bgColor, cv::FILLED);
+
+  putText(_frame, _text, _point, _fontFace, _fontScale, _textColor, _thickness,
+          _lineType, _bottomLeftOrigin);
+}
+
+}  // namespace
+
+DebugRenderer::DebugRenderer(bool _screenOutput, const Size &_videoSize,
+                             double _maxFps, size_t _tailLength,
+                             int _timeoutMs)
+    : mScreenOutput(_screenOutput),
+      mVideoSize(_videoSize),
+      mMaxFps(_maxFps),
+      mPeriod(duration_cast<steady_clock::duration>(
+          duration<double>(_maxFps > 0 ? 1.0 / _maxFps : 0.0))),
+      mTailLength(std::max<size_t>(_tailLength, 1)),
+      mTimeoutMs(_timeoutMs),
+      mNextDue(steady_clock::now().time_since_epoch().count()),
+      mHaveLatest(false),
+      mDropped(0),
+      mRendered(0) {}
+
+DebugRenderer::~DebugRenderer() {
+  if (mScreenOutput) destroyWindow("CrossCounter");
+}
+
+bool DebugRenderer::due() const {
+  // Stream is the only output, which may have no consumers
+  if (!mScreenOutput && !mEncoder && !(mStreamer && mStreamer->hasClients()))
+    return false;
+
+  return steady_clock::now().time_since_epoch().count() >= mNextDue;
+}
+
+void DebugRenderer::offer(RenderSnapshot &&_snapshot) {
+  mNextDue = (steady_clock::now() + mPeriod).time_since_epoch().count();
+
+  unique_lock<mutex> lck(mMutex);
+
+  // Not rendered yet snapshot is replaced by newer one
+  if (mHaveLatest) ++mDropped;
+
+  mLatest = move(_snapshot);
+  mHaveLatest = true;
+
+  mHaveSnapshot.notify_all();
+}
+
+void DebugRenderer::doWork() {
+  RenderSnapshot snapshot;
+
+  {
+    unique_lock<mutex> lck(mMutex);
+
+    if (!mHaveLatest)
+      mHaveSnapshot.wait_for(lck, milliseconds(mTimeoutMs));
+
+    if (!mHaveLatest) return;
+
+    snapshot = move(mLatest);
+    mHaveLatest = false;
+  }
+
+  render(snapshot);
+
+  if (++mRendered % statisticsPeriod == 0) {
+    unique_lock<mutex> lck(mMutex);
+
+    BOOST_LOG_TRIVIAL(debug) << "DebugRenderer: " << mRendered
+                             << " frames rendered, " << mDropped
+                             << " snapshots dropped";
+  }
+}
+
+void DebugRenderer::render(const RenderSnapshot &_snapshot) {
+  // Frame is scaled first, so drawing is done at output resolution. Scaled
+  // view is shared with other stages (and compressed frame is decoded right
+  // at that scale), so drawing is done on its copy.
+  Size size = mVideoSize.empty() ? _snapshot.frame->size() : mVideoSize;
+  Mat frame = _snapshot.frame->bgr(size).clone();
+
+  double sx = double(frame.cols) / std::max(_snapshot.frame->cols(), 1);
+  double sy = double(frame.rows) / std::max(_snapshot.frame->rows(), 1);
+  auto scale = [sx, sy](const Point2d &_p) {
+    return Point2d(_p.x * sx, _p.y * sy);
+  };
+  auto scaleRect = [sx, sy](const Rect2d &_r) {
+    return Rect2d(_r.x * sx, _r.y * sy, _r.width * sx, _r.height * sy);
+  };
+
+  const auto &lines = _snapshot.scene->lines;
+  for (size_t l = 0; l < lines.size(); ++l) {
+    line(frame, scale(lines[l].first), scale(lines[l].second),
+         Scalar(0, 0, 255), 2);
+
+    auto p = scale(lines[l].first);
+    putTextBg(frame,
+              "L" + to_string(l + 1) + " [" +
+                  to_string(_snapshot.lineCounts[l]) + "]",
+              Point(p.x + 10, p.y + 20), FONT_HERSHEY_SIMPLEX, 0.5,
+              Scalar(0, 0, 255), Scalar(40, 40, 40));
+  }
+
+  const auto &zones = _snapshot.scene->zones;
+  for (size_t z = 0; z < zones.size(); ++z) {
+    for (size_t k = 0; k < zones[z].size(); ++k)
+      line(frame, scale(zones[z][k]),
+           scale(zones[z][(k + 1) % zones[z].size()]), Scalar(0, 255, 255),
+           2);
+
+    if (!zones[z].empty()) {
+      auto p = scale(zones[z][0]);
+      putTextBg(frame,
+                "Z" + to_string(z + 1) + " [" +
+                    to_string(_snapshot.zoneOccupancy[z]) + "/" +
+                    to_string(_snapshot.zoneEntries[z]) + "]",
+                Point(p.x + 10, p.y + 20), FONT_HERSHEY_SIMPLEX, 0.5,
+                Scalar(0, 255, 255), Scalar(40, 40, 40));
+    }
+  }
+
+  for (const auto &t : _snapshot.tracks) {
+    for (size_t i = 1; i < t.tail.size(); ++i)
+      line(frame, scale(t.tail[i - 1].point), scale(t.tail[i].point),
+           Scalar(255, 0, 0), 1);
+
+    for (const auto &p : t.tail) {
+      auto c = scale(p.point);
+      rectangle(frame, Rect2d(c.x - 2, c.y - 2, 5, 5),
+                p.verified ? Scalar(0, 255, 0) : Scalar(255, 0, 0), 1);
+    }
+
+    auto r = scaleRect(t.rect);
+    rectangle(frame, r, t.verified ? Scalar(0, 255, 0) : Scalar(255, 0, 0),
+              2);
+
+    putText(frame, "TID = " + to_string(t.trackId),
+            Point(r.x + 10, r.y + 20), FONT_HERSHEY_SIMPLEX, 0.5,
+            t.verified ? Scalar(0, 255, 0) : Scalar(255, 0, 0));
+  }
+
+  putText(frame, timeToStrWithMs(_snapshot.timestamp), Point(10, 20),
+          FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 255, 0));
+
+  if (mScreenOutput) {
+    imshow("CrossCounter", frame);
+    waitKey(1);
+  }
+
+  // Frame is not modified after this, so outputs share it without copying
+  if (mStreamer) mStreamer->push(frame);
+  if (mEncoder) mEncoder->push(frame);
+}
@@ -0,0 +1,92 @@
+#ifndef DEBUGRENDERER_H
+#define DEBUGRENDERER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "crosscounter.h"
+#include "mjpegstreamer.h"
+#include "videoencoder.h"
+
+// What is counted, does not change while counting
+struct CountingScene {
+  std::vector<std::pair<cv::Point2d, cv::Point2d>> lines;
+  std::vector<std::vector<cv::Point2d>> zones;
+};
+
+struct RenderTrack {
+  int trackId;
+  cv::Rect2d rect;
+  bool verified;
+  std::vector<VerifiedPoint> tail;
+};
+
+// State of counting on a frame, enough to draw it
+struct RenderSnapshot {
+  // Shared with pipeline, decoded in renderer thread if it is compressed
+  std::shared_ptr<FrameViews> frame;
+  std::chrono::time_point<std::chrono::system_clock> timestamp;
+  std::shared_ptr<const CountingScene> scene;
+  std::vector<RenderTrack> tracks;
+  std::vector<int> lineCounts;
+  std::vector<int> zoneOccupancy, zoneEntries;
+};
+
+// Draws counting state in its own thread and shows it on screen and/or
+// passes it to video encoder and MJPEG streamer. Snapshots are taken not
+// more often than _maxFps and only if there is an output; if the renderer
+// is busy, only the latest snapshot is kept, so counting never waits for
+// rendering.
+class DebugRenderer {
+ public:
+  explicit DebugRenderer(bool _screenOutput, const cv::Size &_videoSize,
+                         double _maxFps, size_t _tailLength, int _timeoutMs);
+  virtual ~DebugRenderer();
+
+  // Whether next snapshot will be accepted, cheap enough for every frame
+  bool due() const;
+  void offer(RenderSnapshot &&_snapshot);
+
+  size_t tailLength() const { return mTailLength; }
+  double maxFps() const { return mMaxFps; }
+
+  // Optional, must be set before doWork()
+  void setVideoEncoder(const std::shared_ptr<VideoEncoder> &_encoder) {
+    mEncoder = _encoder;
+  }
+  void setMjpegStreamer(const std::shared_ptr<MjpegStreamer> &_streamer) {
+    mStreamer = _streamer;
+  }
+
+  void doWork();
+
+ protected:
+  bool mScreenOutput;
+  std::shared_ptr<VideoEncoder> mEncoder;
+  std::shared_ptr<MjpegStreamer> mStreamer;
+  cv::Size mVideoSize;
+  double mMaxFps;
+  std::chrono::steady_clock::duration mPeriod;
+  size_t mTailLength;
+  int mTimeoutMs;
+
+  // Time of the next snapshot, steady_clock ticks
+  std::atomic<std::chrono::steady_clock::rep> mNextDue;
+
+  RenderSnapshot mLatest;
+  bool mHaveLatest;
+  long mDropped, mRendered;
+  std::mutex mMutex;
+  std::condition_variable mHaveSnapshot;
+
+  void render(const RenderSnapshot &_snapshot);
+};
+
+#endif  // DEBUGRENDERER_H
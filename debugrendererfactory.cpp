@@ -0,0 +1,36 @@
+#include "debugrendererfactory.h"
+
+using namespace cv;
+using namespace std;
+using namespace nlohmann;
+
+shared_ptr<DebugRenderer> DebugRendererFactory::createDebugRenderer(
+    const json &_config) {
+  bool on = _config.contains("on") && _config["on"].is_boolean()
+                ? _config["on"].get<bool>()
+                : false;
+
+  if (!on) return nullptr;
+
+  Size videoSize;
+
+  if (_config.contains("videoWidth") && _config["videoWidth"].is_number() &&
+      _config.contains("videoHeight") && _config["videoHeight"].is_number())
+    videoSize = Size(_config["videoWidth"].get<int>(),
+                     _config["videoHeight"].get<int>());
+
+  return shared_ptr<DebugRenderer>(new DebugRenderer(
+      _config.contains("screenOutput") && _config["screenOutput"].is_boolean()
+          ? _config["screenOutput"].get<bool>()
+          : true,
+      videoSize,
+      _config.contains("maxFps") && _config["maxFps"].is_number()
+          ? _config["maxFps"].get<double>()
+          : 10.0,
+      _config.contains("tailLength") && _config["tailLength"].is_number()
+          ? _config["tailLength"].get<size_t>()
+          : 30,
+      _config.contains("waitTimeoutMs") && _config["waitTimeoutMs"].is_number()
+          ? _config["waitTimeoutMs"].get<int>()
+          : 200));
+}
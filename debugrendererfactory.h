@@ -0,0 +1,20 @@
+#ifndef DEBUGRENDERERFACTORY_H
+#define DEBUGRENDERERFACTORY_H
+
+#include <memory>
+#include <nlohmann/json.hpp>
+
+#include "debugrenderer.h"
+
+class DebugRendererFactory {
+ public:
+  virtual ~DebugRendererFactory() {}
+
+  static std::shared_ptr<DebugRenderer> createDebugRenderer(
+      const nlohmann::json &_config);
+
+ private:
+  explicit DebugRendererFactory() {}
+};
+
+#endif  // DEBUGRENDERERFACTORY_H
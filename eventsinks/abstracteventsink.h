@@ -0,0 +1,25 @@
+#ifndef EVENTSINKS_ABSTRACTEVENTSINK_H
+#define EVENTSINKS_ABSTRACTEVENTSINK_H
+
+#include <vector>
+
+#include "crosscounter.h"
+
+// Destination of counting events. Sinks are called only from the writer
+// thread, so they need no locking and may block.
+class AbstractEventSink {
+ public:
+  explicit AbstractEventSink() {}
+  virtual ~AbstractEventSink() {}
+
+  // Writes batch of events, returns false if the batch is lost
+  virtual bool write(const std::vector<CrossEvent> &_events) = 0;
+
+  // Called by writer thread regularly, also when there are no events
+  virtual void poll() {}
+
+  // Counter totals saved by previous runs, false if sink does not keep them
+  virtual bool recover(CounterState &_state) { return false; }
+};
+
+#endif  // EVENTSINKS_ABSTRACTEVENTSINK_H
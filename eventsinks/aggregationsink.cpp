@@ -0,0 +1,56 @@
+#include "eventsinks/aggregationsink.h"
+
+#include <boost/log/trivial.hpp>
+#include <chrono>
+#include <limits>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+int64_t minuteOf(const time_point<system_clock> &_timestamp) {
+  return duration_cast<minutes>(_timestamp.time_since_epoch()).count();
+}
+
+}  // namespace
+
+AggregationSink::AggregationSink(const string &_fileName, uint32_t _blockRows,
+                                 int _lateMinutes)
+    : mStore(_fileName, true, _blockRows), mLateMinutes(_lateMinutes) {}
+
+AggregationSink::~AggregationSink() {
+  flushBefore(numeric_limits<int64_t>::max());
+}
+
+bool AggregationSink::write(const vector<CrossEvent> &_events) {
+  if (!mStore.isOpen()) return false;
+
+  for (const auto &e : _events) {
+    CountKey key(e.type, e.xdir, e.ydir, e.line_id, e.item_class);
+    ++mBuckets[make_pair(minuteOf(e.timestamp), key.packed())];
+  }
+
+  return true;
+}
+
+void AggregationSink::poll() {
+  flushBefore(minuteOf(system_clock::now()) - mLateMinutes);
+}
+
+void AggregationSink::flushBefore(int64_t _minute) {
+  auto end = mBuckets.lower_bound(make_pair(_minute, uint64_t(0)));
+
+  if (end == mBuckets.begin()) return;
+
+  size_t count = 0;
+  for (auto it = mBuckets.begin(); it != end; ++it, ++count)
+    mStore.append(it->first.first, CountKey::unpack(it->first.second),
+                  it->second);
+
+  mBuckets.erase(mBuckets.begin(), end);
+  mStore.sync();
+
+  BOOST_LOG_TRIVIAL(debug) << "AggregationSink: " << count
+                           << " buckets stored";
+}
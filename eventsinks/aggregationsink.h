@@ -0,0 +1,37 @@
+#ifndef EVENTSINKS_AGGREGATIONSINK_H
+#define EVENTSINKS_AGGREGATIONSINK_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "countstore.h"
+#include "eventsinks/abstracteventsink.h"
+
+// Rolls events into per-minute buckets by line or zone, event kind,
+// direction and item class. Bucket is appended to CountStore, when its
+// minute is over and _lateMinutes more passed for delayed events. Until
+// then buckets are held in memory only: they are stored on shutdown, but
+// about _lateMinutes + 1 last minutes of counts are lost on crash.
+// JournalSink keeps crash-safe totals.
+class AggregationSink : public AbstractEventSink {
+ public:
+  explicit AggregationSink(const std::string &_fileName, uint32_t _blockRows,
+                           int _lateMinutes);
+  virtual ~AggregationSink();
+
+  bool write(const std::vector<CrossEvent> &_events) override;
+  void poll() override;
+
+ private:
+  CountStore mStore;
+  int mLateMinutes;
+  // (minute, packed CountKey) -> count, ordered by minute
+  std::map<std::pair<int64_t, uint64_t>, uint32_t> mBuckets;
+
+  void flushBefore(int64_t _minute);
+};
+
+#endif  // EVENTSINKS_AGGREGATIONSINK_H
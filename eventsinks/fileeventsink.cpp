@@ -0,0 +1,38 @@
+#include "eventsinks/fileeventsink.h"
+
+#include <boost/log/trivial.hpp>
+#include <cerrno>
+#include <cstring>
+
+#include "eventsinks/ndjson.h"
+
+using namespace std;
+
+FileEventSink::FileEventSink(const string &_fileName)
+    : mFileName(_fileName), mFile(fopen(_fileName.c_str(), "ab")) {
+  if (!mFile)
+    BOOST_LOG_TRIVIAL(error) << "FileEventSink: can not open " << mFileName
+                             << ": " << strerror(errno);
+}
+
+FileEventSink::~FileEventSink() {
+  if (mFile) fclose(mFile);
+}
+
+bool FileEventSink::write(const vector<CrossEvent> &_events) {
+  if (!mFile) return false;
+
+  mBuffer.clear();
+  appendNdjson(_events, mBuffer);
+
+  // One write and flush per batch
+  if (fwrite(mBuffer.data(), 1, mBuffer.size(), mFile) != mBuffer.size() ||
+      fflush(mFile) != 0) {
+    BOOST_LOG_TRIVIAL(error) << "FileEventSink: can not write to "
+                             << mFileName << ": " << strerror(errno);
+    clearerr(mFile);
+    return false;
+  }
+
+  return true;
+}
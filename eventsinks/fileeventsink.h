@@ -0,0 +1,24 @@
+#ifndef EVENTSINKS_FILEEVENTSINK_H
+#define EVENTSINKS_FILEEVENTSINK_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "eventsinks/abstracteventsink.h"
+
+// Appends events to a file as newline delimited JSON
+class FileEventSink : public AbstractEventSink {
+ public:
+  explicit FileEventSink(const std::string &_fileName);
+  virtual ~FileEventSink();
+
+  bool write(const std::vector<CrossEvent> &_events) override;
+
+ private:
+  std::string mFileName;
+  FILE *mFile;
+  std::string mBuffer;
+};
+
+#endif  // EVENTSINKS_FILEEVENTSINK_H
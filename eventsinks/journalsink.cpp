@@ -0,0 +1,374 @@
+#include "eventsinks/journalsink.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/crc.hpp>
+#include <boost/log/trivial.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+// Log record, fields are stored in host byte order:
+// type:u8 xdir:i8 ydir:i8 reserved:u8 id:i32 track:i32 crosses:i32
+// occupancy:i32 class:i32 ts_ms:i64 crc:u32 reserved:u32
+const size_t recordSize = 40;
+const size_t recordCrcOffset = 32;
+
+const char snapshotMagic[8] = {'C', 'O', 'S', 'N', 'A', 'P', '0', '1'};
+
+uint32_t crc32(const char *_data, size_t _size) {
+  boost::crc_32_type crc;
+  crc.process_bytes(_data, _size);
+  return crc.checksum();
+}
+
+template <typename T>
+void put(char *_p, T _value) {
+  memcpy(_p, &_value, sizeof(T));
+}
+
+template <typename T>
+T get(const char *_p) {
+  T value;
+  memcpy(&value, _p, sizeof(T));
+  return value;
+}
+
+void encode(const CrossEvent &_event, char *_p) {
+  memset(_p, 0, recordSize);
+  put<uint8_t>(_p, _event.type);
+  put<int8_t>(_p + 1, _event.xdir);
+  put<int8_t>(_p + 2, _event.ydir);
+  put<int32_t>(_p + 4, _event.line_id);
+  put<int32_t>(_p + 8, _event.track_id);
+  put<int32_t>(_p + 12, _event.crosses);
+  put<int32_t>(_p + 16, _event.occupancy);
+  put<int32_t>(_p + 20, _event.item_class);
+  put<int64_t>(_p + 24, duration_cast<milliseconds>(
+                            _event.timestamp.time_since_epoch())
+                            .count());
+  put<uint32_t>(_p + recordCrcOffset, crc32(_p, recordCrcOffset));
+}
+
+bool decode(const char *_p, CrossEvent &_event) {
+  if (get<uint32_t>(_p + recordCrcOffset) != crc32(_p, recordCrcOffset))
+    return false;
+
+  uint8_t type = get<uint8_t>(_p);
+  if (type > CrossEvent::ZONE_EXIT) return false;
+
+  _event.type = static_cast<CrossEvent::Type>(type);
+  _event.xdir = get<int8_t>(_p + 1);
+  _event.ydir = get<int8_t>(_p + 2);
+  _event.line_id = get<int32_t>(_p + 4);
+  _event.track_id = get<int32_t>(_p + 8);
+  _event.crosses = get<int32_t>(_p + 12);
+  _event.occupancy = get<int32_t>(_p + 16);
+  _event.item_class = get<int32_t>(_p + 20);
+  _event.timestamp = time_point<system_clock>(
+      duration_cast<system_clock::duration>(
+          milliseconds(get<int64_t>(_p + 24))));
+
+  return true;
+}
+
+bool writeAll(int _fd, const char *_data, size_t _size) {
+  while (_size > 0) {
+    ssize_t n = ::write(_fd, _data, _size);
+
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+
+    _data += n;
+    _size -= n;
+  }
+
+  return true;
+}
+
+void appendInts(vector<char> &_buf, const vector<int> &_values) {
+  for (int v : _values) {
+    char p[sizeof(int32_t)];
+    put<int32_t>(p, v);
+    _buf.insert(_buf.end(), p, p + sizeof(p));
+  }
+}
+
+}  // namespace
+
+JournalSink::JournalSink(const string &_dir, int _syncIntervalMs,
+                         int _snapshotIntervalS, size_t _maxWalSize)
+    : mWalName(_dir + "/counters.wal"),
+      mSnapshotName(_dir + "/counters.snapshot"),
+      mSyncIntervalMs(_syncIntervalMs),
+      mSnapshotIntervalS(_snapshotIntervalS),
+      mMaxWalSize(_maxWalSize),
+      mWal(-1),
+      mWalSize(0),
+      mDirty(false),
+      mRecovered(false),
+      mLastSync(steady_clock::now()),
+      mLastSnapshot(steady_clock::now()) {
+  if (mkdir(_dir.c_str(), 0755) < 0 && errno != EEXIST)
+    BOOST_LOG_TRIVIAL(error) << "JournalSink: can not create " << _dir << ": "
+                             << strerror(errno);
+
+  load();
+}
+
+JournalSink::~JournalSink() {
+  if (mWal < 0) return;
+
+  sync();
+  close(mWal);
+}
+
+bool JournalSink::write(const vector<CrossEvent> &_events) {
+  if (mWal < 0) return false;
+
+  mBuffer.resize(_events.size() * recordSize);
+  for (size_t i = 0; i < _events.size(); ++i)
+    encode(_events[i], mBuffer.data() + i * recordSize);
+
+  if (!writeAll(mWal, mBuffer.data(), mBuffer.size())) {
+    BOOST_LOG_TRIVIAL(error) << "JournalSink: can not write to " << mWalName
+                             << ": " << strerror(errno);
+    // Partial record would hide the following ones from recovery
+    if (ftruncate(mWal, mWalSize) < 0 ||
+        lseek(mWal, mWalSize, SEEK_SET) < 0) {
+      close(mWal);
+      mWal = -1;
+    }
+    return false;
+  }
+
+  // Totals go to snapshots, so only events in the log are counted
+  for (const auto &e : _events) mState.apply(e);
+
+  mWalSize += mBuffer.size();
+  mDirty = true;
+
+  poll();
+
+  return true;
+}
+
+void JournalSink::poll() {
+  if (mWal < 0) return;
+
+  auto now = steady_clock::now();
+
+  if ((mWalSize >= mMaxWalSize ||
+       now - mLastSnapshot >= seconds(mSnapshotIntervalS)) &&
+      mWalSize > 0) {
+    mLastSnapshot = now;
+    if (writeSnapshot()) return;
+  }
+
+  if (mDirty && now - mLastSync >= milliseconds(mSyncIntervalMs)) sync();
+}
+
+bool JournalSink::recover(CounterState &_state) {
+  if (!mRecovered) return false;
+
+  _state = mState;
+  return true;
+}
+
+void JournalSink::load() {
+  auto t0 = steady_clock::now();
+
+  bool haveSnapshot = readSnapshot();
+  replayWal();
+
+  if (mWal < 0) return;
+
+  mRecovered = haveSnapshot || mWalSize > 0;
+
+  BOOST_LOG_TRIVIAL(info)
+      << "JournalSink: recovered " << (haveSnapshot ? "snapshot and " : "")
+      << mWalSize / recordSize << " log records in "
+      << duration_cast<microseconds>(steady_clock::now() - t0).count()
+      << " us";
+}
+
+bool JournalSink::readSnapshot() {
+  int fd = open(mSnapshotName.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  vector<char> data;
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0)
+    data.insert(data.end(), buf, buf + n);
+  close(fd);
+
+  // magic, lines count, zones count, lines, zone entries, zone exits, crc
+  const size_t header = sizeof(snapshotMagic) + 2 * sizeof(uint32_t);
+
+  if (data.size() < header + sizeof(uint32_t) ||
+      memcmp(data.data(), snapshotMagic, sizeof(snapshotMagic)) != 0) {
+    BOOST_LOG_TRIVIAL(error) << "JournalSink: bad snapshot " << mSnapshotName;
+    return false;
+  }
+
+  size_t lines = get<uint32_t>(data.data() + sizeof(snapshotMagic));
+  size_t zones = get<uint32_t>(data.data() + sizeof(snapshotMagic) + 4);
+  size_t size = header + (lines + 2 * zones) * sizeof(int32_t);
+
+  if (data.size() != size + sizeof(uint32_t) ||
+      get<uint32_t>(data.data() + size) != crc32(data.data(), size)) {
+    BOOST_LOG_TRIVIAL(error) << "JournalSink: bad snapshot " << mSnapshotName;
+    return false;
+  }
+
+  const char *p = data.data() + header;
+  auto readInts = [&p](vector<int> &_values, size_t _count) {
+    _values.resize(_count);
+    for (auto &v : _values) {
+      v = get<int32_t>(p);
+      p += sizeof(int32_t);
+    }
+  };
+
+  readInts(mState.lineCrosses, lines);
+  readInts(mState.zoneEntries, zones);
+  readInts(mState.zoneExits, zones);
+
+  return true;
+}
+
+void JournalSink::replayWal() {
+  mWal = open(mWalName.c_str(), O_RDWR | O_CREAT, 0644);
+
+  if (mWal < 0) {
+    BOOST_LOG_TRIVIAL(error) << "JournalSink: can not open " << mWalName
+                             << ": " << strerror(errno);
+    return;
+  }
+
+  // Records are applied with max(), so replaying the log over a newer
+  // snapshot (crash between snapshot and truncation) is harmless
+  char buf[recordSize * 256];
+  size_t valid = 0, have = 0;
+  bool broken = false;
+  ssize_t n;
+
+  while (!broken && (n = read(mWal, buf + have, sizeof(buf) - have)) > 0) {
+    have += n;
+
+    size_t i = 0;
+    for (; i + recordSize <= have; i += recordSize) {
+      CrossEvent e;
+      if (!decode(buf + i, e)) {
+        broken = true;
+        break;
+      }
+
+      mState.apply(e);
+      valid += recordSize;
+    }
+
+    memmove(buf, buf + i, have - i);
+    have -= i;
+  }
+
+  mWalSize = valid;
+
+  // Torn or broken tail is cut, new records follow the last valid one
+  struct stat st;
+  if (fstat(mWal, &st) == 0 && size_t(st.st_size) != valid) {
+    BOOST_LOG_TRIVIAL(warning)
+        << "JournalSink: " << st.st_size - valid
+        << " bytes of broken log tail are dropped from " << mWalName;
+
+    if (ftruncate(mWal, valid) < 0)
+      BOOST_LOG_TRIVIAL(error) << "JournalSink: can not truncate " << mWalName
+                               << ": " << strerror(errno);
+  }
+
+  lseek(mWal, valid, SEEK_SET);
+}
+
+void JournalSink::sync() {
+  if (mDirty && fdatasync(mWal) < 0)
+    BOOST_LOG_TRIVIAL(error) << "JournalSink: can not sync " << mWalName
+                             << ": " << strerror(errno);
+
+  mDirty = false;
+  mLastSync = steady_clock::now();
+}
+
+bool JournalSink::writeSnapshot() {
+  auto t0 = steady_clock::now();
+
+  vector<char> data(snapshotMagic, snapshotMagic + sizeof(snapshotMagic));
+  vector<int> sizes = {int(mState.lineCrosses.size()),
+                       int(mState.zoneEntries.size())};
+  auto exits = mState.zoneExits;
+  exits.resize(mState.zoneEntries.size(), 0);
+
+  appendInts(data, sizes);
+  appendInts(data, mState.lineCrosses);
+  appendInts(data, mState.zoneEntries);
+  appendInts(data, exits);
+
+  char crc[sizeof(uint32_t)];
+  put<uint32_t>(crc, crc32(data.data(), data.size()));
+  data.insert(data.end(), crc, crc + sizeof(crc));
+
+  // New snapshot replaces the old one atomically, so there is always a
+  // complete snapshot on disk
+  string tmpName = mSnapshotName + ".tmp";
+  int fd = open(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+  if (fd < 0 || !writeAll(fd, data.data(), data.size()) || fsync(fd) < 0) {
+    BOOST_LOG_TRIVIAL(error) << "JournalSink: can not write " << tmpName
+                             << ": " << strerror(errno);
+    if (fd >= 0) close(fd);
+    return false;
+  }
+
+  close(fd);
+
+  if (rename(tmpName.c_str(), mSnapshotName.c_str()) < 0) {
+    BOOST_LOG_TRIVIAL(error) << "JournalSink: can not rename " << tmpName
+                             << ": " << strerror(errno);
+    return false;
+  }
+
+  // Rename is durable after directory sync
+  string dir = mSnapshotName.substr(0, mSnapshotName.rfind('/'));
+  int dirFd = open(dir.c_str(), O_RDONLY);
+  if (dirFd >= 0) {
+    fsync(dirFd);
+    close(dirFd);
+  }
+
+  // All logged events are in the snapshot now
+  if (ftruncate(mWal, 0) < 0 || lseek(mWal, 0, SEEK_SET) < 0) {
+    BOOST_LOG_TRIVIAL(error) << "JournalSink: can not truncate " << mWalName
+                             << ": " << strerror(errno);
+    return false;
+  }
+
+  mWalSize = 0;
+  mDirty = true;  // Truncation itself is synced with the next records
+  sync();
+
+  BOOST_LOG_TRIVIAL(debug)
+      << "JournalSink: snapshot written in "
+      << duration_cast<microseconds>(steady_clock::now() - t0).count()
+      << " us";
+
+  return true;
+}
@@ -0,0 +1,47 @@
+#ifndef EVENTSINKS_JOURNALSINK_H
+#define EVENTSINKS_JOURNALSINK_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "eventsinks/abstracteventsink.h"
+
+// Keeps counter totals on disk. Events are appended to write-ahead log of
+// fixed size checksummed records, log is synced not more often than once
+// per _syncIntervalMs (group commit). When log grows over _maxWalSize bytes
+// or _snapshotIntervalS passed, totals are written to snapshot and log is
+// truncated. Recovery reads snapshot and replays log up to the first broken
+// record.
+class JournalSink : public AbstractEventSink {
+ public:
+  explicit JournalSink(const std::string &_dir, int _syncIntervalMs,
+                       int _snapshotIntervalS, size_t _maxWalSize);
+  virtual ~JournalSink();
+
+  bool write(const std::vector<CrossEvent> &_events) override;
+  void poll() override;
+  bool recover(CounterState &_state) override;
+
+ private:
+  std::string mWalName, mSnapshotName;
+  int mSyncIntervalMs;
+  int mSnapshotIntervalS;
+  size_t mMaxWalSize;
+
+  int mWal;
+  size_t mWalSize;
+  bool mDirty;  // Log has unsynced records
+  bool mRecovered;
+  CounterState mState;  // Totals including all written events
+  std::chrono::time_point<std::chrono::steady_clock> mLastSync, mLastSnapshot;
+  std::vector<char> mBuffer;
+
+  void load();
+  bool readSnapshot();
+  void replayWal();
+  void sync();
+  bool writeSnapshot();
+};
+
+#endif  // EVENTSINKS_JOURNALSINK_H
@@ -0,0 +1,49 @@
+#include "eventsinks/ndjson.h"
+
+#include <chrono>
+#include <cstdio>
+
+using namespace std;
+using namespace std::chrono;
+
+const char *eventTypeName(CrossEvent::Type _type) {
+  switch (_type) {
+    case CrossEvent::LINE_CROSS:
+      return "line_cross";
+    case CrossEvent::ZONE_ENTER:
+      return "zone_enter";
+    case CrossEvent::ZONE_EXIT:
+      return "zone_exit";
+  }
+
+  return "unknown";
+}
+
+void appendNdjson(const vector<CrossEvent> &_events, string &_out) {
+  char buf[256];
+
+  for (const auto &e : _events) {
+    int n = snprintf(
+        buf, sizeof(buf),
+        "{\"type\":\"%s\",\"id\":%d,\"track\":%d,\"ts\":%lld,\"count\":%d,"
+        "\"xdir\":%d,\"ydir\":%d,\"occupancy\":%d,\"class\":%d",
+        eventTypeName(e.type), e.line_id, e.track_id,
+        static_cast<long long>(
+            duration_cast<milliseconds>(e.timestamp.time_since_epoch())
+                .count()),
+        e.crosses, e.xdir, e.ydir, e.occupancy, e.item_class);
+
+    _out.append(buf, n);
+
+    if (!e.thumbnail.empty()) {
+      _out.append(",\"thumbnail\":\"");
+      for (char c : e.thumbnail) {
+        if (c == '"' || c == '\\') _out.push_back('\\');
+        _out.push_back(c);
+      }
+      _out.push_back('"');
+    }
+
+    _out.append("}\n");
+  }
+}
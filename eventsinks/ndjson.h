@@ -0,0 +1,14 @@
+#ifndef EVENTSINKS_NDJSON_H
+#define EVENTSINKS_NDJSON_H
+
+#include <string>
+#include <vector>
+
+#include "crosscounter.h"
+
+const char *eventTypeName(CrossEvent::Type _type);
+
+// Appends events to _out as newline delimited JSON, one object per line
+void appendNdjson(const std::vector<CrossEvent> &_events, std::string &_out);
+
+#endif  // EVENTSINKS_NDJSON_H
@@ -0,0 +1,99 @@
+#include "eventsinks/sqliteeventsink.h"
+
+#include <sqlite3.h>
+
+#include <boost/log/trivial.hpp>
+#include <chrono>
+
+#include "eventsinks/ndjson.h"
+
+using namespace std;
+using namespace std::chrono;
+
+SqliteEventSink::SqliteEventSink(const string &_fileName)
+    : mFileName(_fileName), mDb(nullptr), mInsert(nullptr) {
+  if (sqlite3_open(mFileName.c_str(), &mDb) != SQLITE_OK) {
+    BOOST_LOG_TRIVIAL(error) << "SqliteEventSink: can not open " << mFileName
+                             << ": " << sqlite3_errmsg(mDb);
+    sqlite3_close(mDb);
+    mDb = nullptr;
+    return;
+  }
+
+  // WAL with synchronous=NORMAL syncs only on checkpoints, so a batch
+  // costs one append to the log
+  if (!exec("PRAGMA journal_mode=WAL;") ||
+      !exec("PRAGMA synchronous=NORMAL;") ||
+      !exec("CREATE TABLE IF NOT EXISTS events ("
+            "type TEXT NOT NULL, id INTEGER NOT NULL, track INTEGER NOT NULL, "
+            "ts INTEGER NOT NULL, count INTEGER NOT NULL, "
+            "xdir INTEGER NOT NULL, ydir INTEGER NOT NULL, "
+            "occupancy INTEGER NOT NULL, class INTEGER NOT NULL, "
+            "thumbnail TEXT);") ||
+      sqlite3_prepare_v2(mDb,
+                         "INSERT INTO events (type, id, track, ts, count, "
+                         "xdir, ydir, occupancy, class, thumbnail) "
+                         "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);",
+                         -1, &mInsert, nullptr) != SQLITE_OK) {
+    BOOST_LOG_TRIVIAL(error) << "SqliteEventSink: can not prepare "
+                             << mFileName << ": " << sqlite3_errmsg(mDb);
+    sqlite3_finalize(mInsert);
+    mInsert = nullptr;
+    sqlite3_close(mDb);
+    mDb = nullptr;
+  }
+}
+
+SqliteEventSink::~SqliteEventSink() {
+  sqlite3_finalize(mInsert);
+  sqlite3_close(mDb);
+}
+
+bool SqliteEventSink::write(const vector<CrossEvent> &_events) {
+  if (!mDb) return false;
+
+  if (!exec("BEGIN;")) return false;
+
+  for (const auto &e : _events) {
+    sqlite3_bind_text(mInsert, 1, eventTypeName(e.type), -1, SQLITE_STATIC);
+    sqlite3_bind_int(mInsert, 2, e.line_id);
+    sqlite3_bind_int(mInsert, 3, e.track_id);
+    sqlite3_bind_int64(
+        mInsert, 4,
+        duration_cast<milliseconds>(e.timestamp.time_since_epoch()).count());
+    sqlite3_bind_int(mInsert, 5, e.crosses);
+    sqlite3_bind_int(mInsert, 6, e.xdir);
+    sqlite3_bind_int(mInsert, 7, e.ydir);
+    sqlite3_bind_int(mInsert, 8, e.occupancy);
+    sqlite3_bind_int(mInsert, 9, e.item_class);
+    if (e.thumbnail.empty())
+      sqlite3_bind_null(mInsert, 10);
+    else
+      sqlite3_bind_text(mInsert, 10, e.thumbnail.c_str(), -1, SQLITE_STATIC);
+
+    int rc = sqlite3_step(mInsert);
+    sqlite3_reset(mInsert);
+
+    if (rc != SQLITE_DONE) {
+      BOOST_LOG_TRIVIAL(error) << "SqliteEventSink: can not insert into "
+                               << mFileName << ": " << sqlite3_errmsg(mDb);
+      exec("ROLLBACK;");
+      return false;
+    }
+  }
+
+  return exec("COMMIT;");
+}
+
+bool SqliteEventSink::exec(const char *_sql) {
+  char *err = nullptr;
+
+  if (sqlite3_exec(mDb, _sql, nullptr, nullptr, &err) != SQLITE_OK) {
+    BOOST_LOG_TRIVIAL(error) << "SqliteEventSink: " << _sql << " failed: "
+                             << (err ? err : "unknown error");
+    sqlite3_free(err);
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,29 @@
+#ifndef EVENTSINKS_SQLITEEVENTSINK_H
+#define EVENTSINKS_SQLITEEVENTSINK_H
+
+#include <string>
+#include <vector>
+
+#include "eventsinks/abstracteventsink.h"
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+// Inserts events into "events" table of SQLite database in WAL mode, one
+// transaction per batch
+class SqliteEventSink : public AbstractEventSink {
+ public:
+  explicit SqliteEventSink(const std::string &_fileName);
+  virtual ~SqliteEventSink();
+
+  bool write(const std::vector<CrossEvent> &_events) override;
+
+ private:
+  std::string mFileName;
+  sqlite3 *mDb;
+  sqlite3_stmt *mInsert;
+
+  bool exec(const char *_sql);
+};
+
+#endif  // EVENTSINKS_SQLITEEVENTSINK_H
@@ -0,0 +1,87 @@
+#include "eventsinks/unixsocketeventsink.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/log/trivial.hpp>
+#include <cerrno>
+#include <cstring>
+
+#include "eventsinks/ndjson.h"
+
+using namespace std;
+using namespace std::chrono;
+
+UnixSocketEventSink::UnixSocketEventSink(const string &_path,
+                                         int _reconnectMs)
+    : mPath(_path),
+      mReconnectMs(_reconnectMs),
+      mSocket(-1),
+      mLastConnect(steady_clock::now() - milliseconds(_reconnectMs)) {}
+
+UnixSocketEventSink::~UnixSocketEventSink() { disconnect(); }
+
+bool UnixSocketEventSink::write(const vector<CrossEvent> &_events) {
+  if (mSocket < 0 && !connect()) return false;
+
+  mBuffer.clear();
+  appendNdjson(_events, mBuffer);
+
+  for (size_t sent = 0; sent < mBuffer.size();) {
+    // MSG_NOSIGNAL: closed peer gives EPIPE instead of SIGPIPE
+    ssize_t n = send(mSocket, mBuffer.data() + sent, mBuffer.size() - sent,
+                     MSG_NOSIGNAL);
+
+    if (n < 0) {
+      if (errno == EINTR) continue;
+
+      BOOST_LOG_TRIVIAL(error) << "UnixSocketEventSink: can not send to "
+                               << mPath << ": " << strerror(errno);
+      disconnect();
+      return false;
+    }
+
+    sent += n;
+  }
+
+  return true;
+}
+
+bool UnixSocketEventSink::connect() {
+  auto now = steady_clock::now();
+  if (now - mLastConnect < milliseconds(mReconnectMs)) return false;
+  mLastConnect = now;
+
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+
+  if (mPath.size() >= sizeof(addr.sun_path)) {
+    BOOST_LOG_TRIVIAL(error) << "UnixSocketEventSink: path is too long: "
+                             << mPath;
+    return false;
+  }
+
+  strncpy(addr.sun_path, mPath.c_str(), sizeof(addr.sun_path) - 1);
+
+  mSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (mSocket < 0 ||
+      ::connect(mSocket, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) <
+          0) {
+    BOOST_LOG_TRIVIAL(warning) << "UnixSocketEventSink: can not connect to "
+                               << mPath << ": " << strerror(errno);
+    disconnect();
+    return false;
+  }
+
+  BOOST_LOG_TRIVIAL(info) << "UnixSocketEventSink: connected to " << mPath;
+
+  return true;
+}
+
+void UnixSocketEventSink::disconnect() {
+  if (mSocket >= 0) close(mSocket);
+  mSocket = -1;
+}
@@ -0,0 +1,31 @@
+#ifndef EVENTSINKS_UNIXSOCKETEVENTSINK_H
+#define EVENTSINKS_UNIXSOCKETEVENTSINK_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "eventsinks/abstracteventsink.h"
+
+// Sends events as newline delimited JSON to a local stream socket, which is
+// listened by some consumer. Connection is reestablished not more often than
+// once per _reconnectMs, batches are lost while there is no consumer.
+class UnixSocketEventSink : public AbstractEventSink {
+ public:
+  explicit UnixSocketEventSink(const std::string &_path, int _reconnectMs);
+  virtual ~UnixSocketEventSink();
+
+  bool write(const std::vector<CrossEvent> &_events) override;
+
+ private:
+  std::string mPath;
+  int mReconnectMs;
+  int mSocket;
+  std::chrono::time_point<std::chrono::steady_clock> mLastConnect;
+  std::string mBuffer;
+
+  bool connect();
+  void disconnect();
+};
+
+#endif  // EVENTSINKS_UNIXSOCKETEVENTSINK_H
@@ -0,0 +1,147 @@
+#include "eventwriter.h"
+
+#include <boost/log/trivial.hpp>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+// Statistics are logged every this number of seconds
+const int statisticsPeriodS = 60;
+
+}  // namespace
+
+EventWriter::EventWriter(vector<unique_ptr<AbstractEventSink>> _sinks,
+                         size_t _queueSize, size_t _batchSize,
+                         int _flushIntervalMs, int _timeoutMs)
+    : mSinks(move(_sinks)),
+      mCapacity(std::max<size_t>(_queueSize, 1)),
+      mBatchSize(std::max<size_t>(_batchSize, 1)),
+      mFlushIntervalMs(_flushIntervalMs),
+      mTimeoutMs(_timeoutMs),
+      mQueue(mCapacity),
+      mPushed(0),
+      mWritten(0),
+      mDropped(0),
+      mLost(0),
+      mLastStatistics(steady_clock::now()),
+      mFailedBatches(0) {
+  mBatch.reserve(mBatchSize);
+}
+
+EventWriter::~EventWriter() { flush(); }
+
+void EventWriter::push(const list<CrossEvent> &_input) {
+  size_t pushed = 0;
+
+  for (const auto &e : _input) {
+    if (!mQueue.push(e)) break;
+    ++pushed;
+  }
+
+  mPushed += pushed;
+
+  if (pushed < _input.size()) {
+    mDropped += _input.size() - pushed;
+
+    BOOST_LOG_TRIVIAL(warning) << "EventWriter: queue is full, "
+                               << _input.size() - pushed
+                               << " events are dropped";
+  }
+
+  if (pushed > 0) mWake.notify_one();
+}
+
+void EventWriter::doWork() {
+  {
+    unique_lock<mutex> lck(mWakeMutex);
+
+    // Producer does not lock mWakeMutex, so wakeup may be missed, timeout
+    // limits the delay
+    auto timeout = milliseconds(mBatch.empty() ? mTimeoutMs : mFlushIntervalMs);
+    mWake.wait_for(lck, timeout, [this]() {
+      return mQueue.read_available() + mBatch.size() >= mBatchSize;
+    });
+  }
+
+  drainQueue();
+
+  if (!mBatch.empty() &&
+      steady_clock::now() - mBatchStart >= milliseconds(mFlushIntervalMs))
+    writeBatch();
+
+  poll();
+
+  auto now = steady_clock::now();
+  if (now - mLastStatistics >= seconds(statisticsPeriodS)) {
+    mLastStatistics = now;
+
+    BOOST_LOG_TRIVIAL(info)
+        << "EventWriter: backlog " << backlog() << " events, written "
+        << mWritten << ", dropped " << mDropped << ", lost " << mLost
+        << ", failed batches " << mFailedBatches;
+  }
+}
+
+void EventWriter::flush() {
+  drainQueue();
+  if (!mBatch.empty()) writeBatch();
+}
+
+void EventWriter::poll() {
+  for (auto &s : mSinks) s->poll();
+}
+
+CounterState EventWriter::recover() {
+  CounterState state;
+
+  for (auto &sink : mSinks) {
+    CounterState s;
+    if (sink->recover(s)) state.merge(s);
+  }
+
+  return state;
+}
+
+size_t EventWriter::backlog() const { return mPushed - mWritten - mLost; }
+
+void EventWriter::drainQueue() {
+  CrossEvent e;
+
+  while (mQueue.pop(e)) {
+    if (mBatch.empty()) mBatchStart = steady_clock::now();
+
+    mBatch.push_back(e);
+
+    if (mBatch.size() >= mBatchSize) writeBatch();
+  }
+}
+
+void EventWriter::writeBatch() {
+  auto t0 = steady_clock::now();
+
+  bool failed = false;
+
+  for (auto &s : mSinks)
+    if (!s->write(mBatch)) {
+      ++mFailedBatches;
+      failed = true;
+    }
+
+  if (failed) {
+    mLost += mBatch.size();
+
+    BOOST_LOG_TRIVIAL(error) << "EventWriter: " << mBatch.size()
+                             << " events are lost, some sink failed";
+  } else {
+    mWritten += mBatch.size();
+
+    BOOST_LOG_TRIVIAL(trace)
+        << "EventWriter: " << mBatch.size() << " events written in "
+        << duration_cast<microseconds>(steady_clock::now() - t0).count()
+        << " us, backlog " << backlog();
+  }
+
+  mBatch.clear();
+}
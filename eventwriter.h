@@ -0,0 +1,72 @@
+#ifndef EVENTWRITER_H
+#define EVENTWRITER_H
+
+#include <atomic>
+#include <boost/lockfree/spsc_queue.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "crosscounter.h"
+#include "eventsinks/abstracteventsink.h"
+
+// Writes counting events to sinks in background. Events are passed through
+// bounded lock-free queue, so pushing never waits for I/O; if the queue is
+// full, events are dropped and counted. Writer thread collects events into
+// batches, which are flushed when _batchSize events are collected or
+// _flushIntervalMs passed since the first event of the batch. Batch is
+// counted as lost, if any sink fails to write it.
+class EventWriter {
+ public:
+  explicit EventWriter(std::vector<std::unique_ptr<AbstractEventSink>> _sinks,
+                       size_t _queueSize, size_t _batchSize,
+                       int _flushIntervalMs, int _timeoutMs);
+  virtual ~EventWriter();
+
+  // Single producer, must be called from one thread only
+  void push(const std::list<CrossEvent> &_input);
+
+  // Writer thread
+  void doWork();
+  // Writes all queued events, used on shutdown
+  void flush();
+  // Periodic work of sinks (sync, snapshots, stored buckets), done by
+  // doWork(); called directly when writer thread is not run
+  void poll();
+
+  // Counter totals saved by sinks, the greatest of them
+  CounterState recover();
+
+  // Events pushed, but not written or lost yet
+  size_t backlog() const;
+  long dropped() const { return mDropped; }
+  long lost() const { return mLost; }
+  // Events, which the queue holds, more are dropped by push()
+  size_t capacity() const { return mCapacity; }
+
+ protected:
+  std::vector<std::unique_ptr<AbstractEventSink>> mSinks;
+  size_t mCapacity;
+  size_t mBatchSize;
+  int mFlushIntervalMs;
+  int mTimeoutMs;
+
+  boost::lockfree::spsc_queue<CrossEvent> mQueue;
+  std::atomic<long> mPushed, mWritten, mDropped, mLost;
+  // Wakes up writer, producer notifies it without locking
+  std::mutex mWakeMutex;
+  std::condition_variable mWake;
+
+  std::vector<CrossEvent> mBatch;
+  std::chrono::time_point<std::chrono::steady_clock> mBatchStart;
+  std::chrono::time_point<std::chrono::steady_clock> mLastStatistics;
+  long mFailedBatches;
+
+  void drainQueue();
+  void writeBatch();
+};
+
+#endif  // EVENTWRITER_H
@@ -0,0 +1,116 @@
+#include "eventwriterfactory.h"
+
+#include <boost/log/trivial.hpp>
+
+#include "eventsinks/fileeventsink.h"
+#ifdef HAVE_SQLITE3
+#include "eventsinks/sqliteeventsink.h"
+#endif
+#ifdef __unix__
+#include "eventsinks/aggregationsink.h"
+#include "eventsinks/journalsink.h"
+#include "eventsinks/unixsocketeventsink.h"
+#endif
+
+using namespace std;
+using namespace nlohmann;
+
+shared_ptr<EventWriter> EventWriterFactory::createEventWriter(
+    const json &_config) {
+  bool on = _config.contains("on") && _config["on"].is_boolean()
+                ? _config["on"].get<bool>()
+                : false;
+
+  if (!on) return nullptr;
+
+  vector<unique_ptr<AbstractEventSink>> sinks;
+
+  if (_config.contains("Sinks") && _config["Sinks"].is_array())
+    for (const auto &c : _config["Sinks"]) {
+      auto sink = createSink(c);
+      if (sink) sinks.push_back(move(sink));
+    }
+
+  return shared_ptr<EventWriter>(new EventWriter(
+      move(sinks),
+      _config.contains("queueSize") && _config["queueSize"].is_number()
+          ? _config["queueSize"].get<size_t>()
+          : 4096,
+      _config.contains("batchSize") && _config["batchSize"].is_number()
+          ? _config["batchSize"].get<size_t>()
+          : 64,
+      _config.contains("flushIntervalMs") &&
+              _config["flushIntervalMs"].is_number()
+          ? _config["flushIntervalMs"].get<int>()
+          : 1000,
+      _config.contains("waitTimeoutMs") && _config["waitTimeoutMs"].is_number()
+          ? _config["waitTimeoutMs"].get<int>()
+          : 200));
+}
+
+unique_ptr<AbstractEventSink> EventWriterFactory::createSink(
+    const json &_config) {
+  string name = _config.contains("typeName") && _config["typeName"].is_string()
+                    ? _config["typeName"].get<string>()
+                    : "";
+
+  if (name == "FileEventSink")
+    return unique_ptr<AbstractEventSink>(new FileEventSink(
+        _config.contains("fileName") && _config["fileName"].is_string()
+            ? _config["fileName"].get<string>()
+            : "events.ndjson"));
+
+#ifdef HAVE_SQLITE3
+  if (name == "SqliteEventSink")
+    return unique_ptr<AbstractEventSink>(new SqliteEventSink(
+        _config.contains("fileName") && _config["fileName"].is_string()
+            ? _config["fileName"].get<string>()
+            : "events.db"));
+#endif
+
+#ifdef __unix__
+  if (name == "UnixSocketEventSink")
+    return unique_ptr<AbstractEventSink>(new UnixSocketEventSink(
+        _config.contains("path") && _config["path"].is_string()
+            ? _config["path"].get<string>()
+            : "/tmp/carsobserver.sock",
+        _config.contains("reconnectMs") && _config["reconnectMs"].is_number()
+            ? _config["reconnectMs"].get<int>()
+            : 5000));
+
+  if (name == "JournalSink")
+    return unique_ptr<AbstractEventSink>(new JournalSink(
+        _config.contains("dir") && _config["dir"].is_string()
+            ? _config["dir"].get<string>()
+            : "journal",
+        _config.contains("syncIntervalMs") &&
+                _config["syncIntervalMs"].is_number()
+            ? _config["syncIntervalMs"].get<int>()
+            : 1000,
+        _config.contains("snapshotIntervalS") &&
+                _config["snapshotIntervalS"].is_number()
+            ? _config["snapshotIntervalS"].get<int>()
+            : 300,
+        _config.contains("maxWalSize") && _config["maxWalSize"].is_number()
+            ? _config["maxWalSize"].get<size_t>()
+            : 1048576));
+
+  if (name == "AggregationSink")
+    return unique_ptr<AbstractEventSink>(new AggregationSink(
+        _config.contains("fileName") && _config["fileName"].is_string()
+            ? _config["fileName"].get<string>()
+            : "counts.bin",
+        _config.contains("blockRows") && _config["blockRows"].is_number()
+            ? _config["blockRows"].get<uint32_t>()
+            : 4096,
+        _config.contains("lateMinutes") && _config["lateMinutes"].is_number()
+            ? _config["lateMinutes"].get<int>()
+            : 1));
+#endif
+
+  BOOST_LOG_TRIVIAL(error) << "EventWriterFactory: unknown or unsupported "
+                              "sink type \""
+                           << name << "\"";
+
+  return nullptr;
+}
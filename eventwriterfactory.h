@@ -0,0 +1,24 @@
+#ifndef EVENTWRITERFACTORY_H
+#define EVENTWRITERFACTORY_H
+
+#include <memory>
+#include <nlohmann/json.hpp>
+
+#include "eventsinks/abstracteventsink.h"
+#include "eventwriter.h"
+
+class EventWriterFactory {
+ public:
+  virtual ~EventWriterFactory() {}
+
+  static std::shared_ptr<EventWriter> createEventWriter(
+      const nlohmann::json &_config);
+
+ private:
+  EventWriterFactory() {}
+
+  static std::unique_ptr<AbstractEventSink> createSink(
+      const nlohmann::json &_config);
+};
+
+#endif  // EVENTWRITERFACTORY_H
@@ -0,0 +1,103 @@
+#include "framearena.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <cstdint>
+
+using namespace std;
+
+namespace {
+
+// Statistics are logged every this number of frames
+const long statisticsPeriod = 1000;
+
+}  // namespace
+
+FrameArena::FrameArena(size_t _capacity)
+    : mBuffer(new char[_capacity]),
+      mCapacity(_capacity),
+      mUsed(0),
+      mFallbacks(0) {}
+
+void *FrameArena::allocate(size_t _bytes, size_t _alignment) {
+  uintptr_t base = reinterpret_cast<uintptr_t>(mBuffer.get());
+  uintptr_t p = (base + mUsed + _alignment - 1) & ~(uintptr_t(_alignment) - 1);
+
+  if (p + _bytes <= base + mCapacity) {
+    mUsed = p + _bytes - base;
+    return reinterpret_cast<void *>(p);
+  }
+
+  ++mFallbacks;
+  return ::operator new(_bytes);
+}
+
+void FrameArena::deallocate(void *_p, size_t) noexcept {
+  // Arena memory is released by reset() only
+  char *p = static_cast<char *>(_p);
+  if (p < mBuffer.get() || p >= mBuffer.get() + mCapacity)
+    ::operator delete(_p);
+}
+
+void FrameArena::reset() {
+  mUsed = 0;
+  mFallbacks = 0;
+}
+
+FrameArenaPool::FrameArenaPool(size_t _arenaCapacity)
+    : mArenaCapacity(_arenaCapacity),
+      mArenasCount(0),
+      mHighWaterMark(0),
+      mFallbackAllocations(0),
+      mFramesCount(0) {}
+
+shared_ptr<FrameArena> FrameArenaPool::acquire() {
+  unique_ptr<FrameArena> arena;
+
+  {
+    unique_lock<mutex> lck(mMutex);
+
+    if (!mFree.empty()) {
+      arena = move(mFree.back());
+      mFree.pop_back();
+    } else {
+      ++mArenasCount;
+    }
+  }
+
+  if (!arena) arena.reset(new FrameArena(mArenaCapacity));
+
+  // Pool lives until all its arenas are returned
+  auto self = shared_from_this();
+  return shared_ptr<FrameArena>(arena.release(), [self](FrameArena *_arena) {
+    self->release(_arena);
+  });
+}
+
+size_t FrameArenaPool::highWaterMark() const {
+  unique_lock<mutex> lck(mMutex);
+
+  return mHighWaterMark;
+}
+
+long FrameArenaPool::fallbackAllocations() const {
+  unique_lock<mutex> lck(mMutex);
+
+  return mFallbackAllocations;
+}
+
+void FrameArenaPool::release(FrameArena *_arena) {
+  unique_lock<mutex> lck(mMutex);
+
+  mHighWaterMark = std::max(mHighWaterMark, _arena->used());
+  mFallbackAllocations += _arena->fallbacks();
+
+  if (++mFramesCount % statisticsPeriod == 0)
+    BOOST_LOG_TRIVIAL(debug)
+        << "FrameArenaPool: " << mArenasCount << " arenas, high-water mark "
+        << mHighWaterMark << " of " << mArenaCapacity << " bytes, "
+        << mFallbackAllocations << " fallback allocations";
+
+  _arena->reset();
+  mFree.push_back(unique_ptr<FrameArena>(_arena));
+}
@@ -0,0 +1,119 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Monotonic memory for transient data of one frame. Allocations are bumped
+// from a fixed buffer and released in bulk by reset(). If the buffer is
+// exhausted, allocations fall back to the heap.
+// A frame is processed by one stage at a time, so there is no locking.
+class FrameArena {
+ public:
+  explicit FrameArena(size_t _capacity);
+
+  void *allocate(size_t _bytes, size_t _alignment);
+  // Does not change the arena, so containers may be destroyed by any thread
+  void deallocate(void *_p, size_t _bytes) noexcept;
+
+  void reset();
+
+  size_t capacity() const { return mCapacity; }
+  size_t used() const { return mUsed; }
+  long fallbacks() const { return mFallbacks; }
+
+ private:
+  std::unique_ptr<char[]> mBuffer;
+  size_t mCapacity;
+  size_t mUsed;
+  long mFallbacks;  // Heap allocations since last reset
+};
+
+// Gives arenas to frames. Arena returns to the pool, when the last reference
+// to it is dropped, i.e. when its frame leaves the pipeline.
+// Must be owned by std::shared_ptr.
+class FrameArenaPool : public std::enable_shared_from_this<FrameArenaPool> {
+ public:
+  explicit FrameArenaPool(size_t _arenaCapacity);
+
+  std::shared_ptr<FrameArena> acquire();
+
+  size_t highWaterMark() const;  // The most bytes used by one frame
+  long fallbackAllocations() const;
+
+ private:
+  size_t mArenaCapacity;
+  std::vector<std::unique_ptr<FrameArena>> mFree;
+  size_t mArenasCount;
+  size_t mHighWaterMark;
+  long mFallbackAllocations;
+  long mFramesCount;
+  mutable std::mutex mMutex;
+
+  void release(FrameArena *_arena);
+};
+
+// STL allocator over FrameArena. Default constructed one uses the heap, so
+// long living containers may have the same type as frame data.
+// Copies are made on the heap, moved containers keep arena memory.
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  template <typename U>
+  struct rebind {
+    using other = ArenaAllocator<U>;
+  };
+
+  ArenaAllocator() noexcept : mArena(nullptr) {}
+  ArenaAllocator(FrameArena *_arena) noexcept : mArena(_arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &_other) noexcept
+      : mArena(_other.arena()) {}
+
+  T *allocate(size_t _n) {
+    if (mArena)
+      return static_cast<T *>(mArena->allocate(_n * sizeof(T), alignof(T)));
+
+    return static_cast<T *>(::operator new(_n * sizeof(T)));
+  }
+
+  void deallocate(T *_p, size_t _n) noexcept {
+    if (mArena)
+      mArena->deallocate(_p, _n * sizeof(T));
+    else
+      ::operator delete(_p);
+  }
+
+  ArenaAllocator select_on_container_copy_construction() const {
+    return ArenaAllocator();
+  }
+
+  FrameArena *arena() const { return mArena; }
+
+ private:
+  FrameArena *mArena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T> &_a, const ArenaAllocator<U> &_b) {
+  return _a.arena() == _b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &_a, const ArenaAllocator<U> &_b) {
+  return !(_a == _b);
+}
+
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif  // FRAMEARENA_H
@@ -0,0 +1,192 @@
+#include "frameviews.h"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/log/trivial.hpp>
+#include <cstdio>
+#include <opencv2/dnn.hpp>
+#include <opencv2/imgproc.hpp>
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+atomic<long> framesCount(0), decodesCount(0), conversionsCount(0),
+    resizesCount(0), blobsCount(0), hitsCount(0);
+
+template <class K>
+const Mat *findView(const vector<pair<K, Mat>> &_views, const K &_key) {
+  for (const auto &v : _views)
+    if (v.first == _key) {
+      ++hitsCount;
+      return &v.second;
+    }
+
+  return nullptr;
+}
+
+}  // namespace
+
+string FrameViews::Statistics::toString() const {
+  double n = std::max(frames, 1L);
+  char buf[256];
+
+  snprintf(buf, sizeof(buf),
+           "%ld frames, per frame: %.2f decodes, %.2f conversions, %.2f "
+           "resizes, %.2f blobs, %.2f cache hits",
+           frames, decodes / n, conversions / n, resizes / n, blobs / n,
+           hits / n);
+
+  return buf;
+}
+
+bool FrameViews::BlobKey::operator==(const BlobKey &_other) const {
+  return scaleFactor == _other.scaleFactor && size == _other.size &&
+         mean == _other.mean && swapRB == _other.swapRB &&
+         crop == _other.crop && ddepth == _other.ddepth;
+}
+
+FrameViews::FrameViews(const Mat &_bgr, const shared_ptr<void> &_lease)
+    : mLease(_lease),
+      mImageSize(_bgr.size()),
+      mRoi(0, 0, _bgr.cols, _bgr.rows) {
+  mBgrLevels[0] = _bgr;
+  ++framesCount;
+}
+
+FrameViews::FrameViews(const JpegBuffer &_jpeg, const Size &_imageSize,
+                       const Rect &_roi)
+    : mJpeg(_jpeg),
+      mImageSize(_imageSize),
+      mRoi(_roi & Rect(Point(), _imageSize)) {
+  ++framesCount;
+}
+
+Mat FrameViews::bgr() {
+  unique_lock<mutex> lck(mMutex);
+
+  return level(0, false)(mRoi);
+}
+
+Mat FrameViews::bgr(const Size &_size) {
+  if (_size == size()) return bgr();
+
+  unique_lock<mutex> lck(mMutex);
+
+  if (auto view = findView(mBgrViews, _size)) return *view;
+
+  Rect window(0, 0, cols(), rows());
+  int l = levelFor(window, _size);
+  Mat view = scaled(level(l, false), l, window, _size);
+
+  mBgrViews.push_back(make_pair(_size, view));
+
+  return view;
+}
+
+Mat FrameViews::gray(const Rect &_window, const Size &_size) {
+  unique_lock<mutex> lck(mMutex);
+
+  bool whole = _window == Rect(0, 0, cols(), rows());
+
+  if (whole)
+    if (auto view = findView(mGrayViews, _size)) return *view;
+
+  int l = levelFor(_window, _size);
+  Mat view = scaled(level(l, true), l, _window, _size);
+
+  if (whole) mGrayViews.push_back(make_pair(_size, view));
+
+  return view;
+}
+
+Mat FrameViews::blob(double _scaleFactor, const Size &_size,
+                     const Scalar &_mean, bool _swapRB, bool _crop,
+                     int _ddepth) {
+  BlobKey key{_scaleFactor, _size, _mean, _swapRB, _crop, _ddepth};
+
+  {
+    unique_lock<mutex> lck(mMutex);
+
+    if (auto blob = findView(mBlobs, key)) return *blob;
+  }
+
+  // Made of full size frame, not of scaled views: their reduced decoding
+  // and INTER_AREA would change network input
+  Mat blob = dnn::blobFromImage(bgr(), _scaleFactor, _size, _mean, _swapRB,
+                                _crop, _ddepth);
+  ++blobsCount;
+
+  unique_lock<mutex> lck(mMutex);
+
+  mBlobs.push_back(make_pair(key, blob));
+
+  return blob;
+}
+
+FrameViews::Statistics FrameViews::statistics() {
+  return Statistics{framesCount,   decodesCount, conversionsCount,
+                    resizesCount,  blobsCount,   hitsCount};
+}
+
+int FrameViews::levelFor(const Rect &_window, const Size &_size) const {
+  int l = 0;
+
+  // Decoded frame has full size level only
+  if (mJpeg)
+    while (l + 1 < scaleLevels && _window.width >= _size.width << (l + 1) &&
+           _window.height >= _size.height << (l + 1))
+      ++l;
+
+  return l;
+}
+
+const Mat &FrameViews::level(int _level, bool _gray) {
+  Mat &image = _gray ? mGrayLevels[_level] : mBgrLevels[_level];
+
+  if (!image.empty()) return image;
+
+  const Mat &bgr = mBgrLevels[_level];
+
+  // Gray of already decoded BGR is cheaper than another decode
+  if (mJpeg && (!_gray || bgr.empty())) {
+    Size size((mImageSize.width + (1 << _level) - 1) >> _level,
+              (mImageSize.height + (1 << _level) - 1) >> _level);
+
+    ++decodesCount;
+
+    if (!JpegDecoder::decode(*mJpeg, 1 << _level, _gray, image) ||
+        image.size() != size) {
+      // Stages get black frame instead
+      BOOST_LOG_TRIVIAL(warning) << "FrameViews: broken JPEG frame";
+      image = Mat::zeros(size, _gray ? CV_8UC1 : CV_8UC3);
+    }
+  } else if (_gray && !bgr.empty()) {
+    ++conversionsCount;
+    cvtColor(bgr, image, COLOR_BGR2GRAY);
+  }
+
+  return image;
+}
+
+Mat FrameViews::scaled(const Mat &_level, int _levelIndex, const Rect &_window,
+                       const Size &_size) {
+  // Window in coordinates of scaled image
+  Rect window = Rect((mRoi.x + _window.x) >> _levelIndex,
+                     (mRoi.y + _window.y) >> _levelIndex,
+                     std::max(_window.width >> _levelIndex, 1),
+                     std::max(_window.height >> _levelIndex, 1)) &
+                Rect(0, 0, _level.cols, _level.rows);
+
+  if (window.empty()) return Mat::zeros(_size, _level.type());
+
+  if (window.size() == _size) return _level(window);
+
+  ++resizesCount;
+
+  Mat result;
+  resize(_level(window), result, _size, 0, 0, INTER_AREA);
+
+  return result;
+}
@@ -0,0 +1,103 @@
+#ifndef FRAMEVIEWS_H
+#define FRAMEVIEWS_H
+
+#include <memory>
+#include <mutex>
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+
+#include "jpegdecoder.h"
+
+// Captured frame in the forms stages need: gray and BGR at any size and
+// network input blobs. Every form is made on the first request and kept while
+// the frame lives, so each conversion is done once per frame whichever stages
+// ask for it. Views are shared and must not be modified.
+//
+// Frame may be kept compressed. Then views are decoded at the smallest DCT
+// scale (1/2, 1/4, 1/8), which still gives the requested resolution, gray
+// ones straight to gray, and full size BGR is decoded only if some stage asks
+// for it.
+class FrameViews {
+ public:
+  // Work of all frames since start
+  struct Statistics {
+    long frames;
+    long decodes;      // JPEG decodes at any scale
+    long conversions;  // Color conversions of decoded frames
+    long resizes;
+    long blobs;
+    long hits;  // Requests served from cache
+
+    std::string toString() const;
+  };
+
+  // Decoded frame. _bgr memory may be not owned by it (e.g. a driver buffer),
+  // then _lease keeps it until the frame is released, and views of such frame
+  // are valid while it lives.
+  explicit FrameViews(const cv::Mat &_bgr,
+                      const std::shared_ptr<void> &_lease = nullptr);
+  // Compressed frame of _imageSize, only its _roi is the frame
+  explicit FrameViews(const JpegBuffer &_jpeg, const cv::Size &_imageSize,
+                      const cv::Rect &_roi);
+
+  int cols() const { return mRoi.width; }
+  int rows() const { return mRoi.height; }
+  cv::Size size() const { return mRoi.size(); }
+
+  // Empty for decoded frame
+  const JpegBuffer &jpeg() const { return mJpeg; }
+
+  // Full size BGR. Broken compressed frame gives black views.
+  cv::Mat bgr();
+  // Whole frame in BGR scaled to _size
+  cv::Mat bgr(const cv::Size &_size);
+
+  // _window of frame (in frame coordinates) in gray, scaled to _size. Only
+  // whole frame views are cached, windows are different for every caller.
+  cv::Mat gray(const cv::Rect &_window, const cv::Size &_size);
+  cv::Mat gray(const cv::Size &_size) {
+    return gray(cv::Rect(0, 0, cols(), rows()), _size);
+  }
+
+  // Exactly cv::dnn::blobFromImage of bgr(), only cached
+  cv::Mat blob(double _scaleFactor, const cv::Size &_size,
+               const cv::Scalar &_mean, bool _swapRB, bool _crop,
+               int _ddepth);
+
+  static Statistics statistics();
+
+ private:
+  enum { scaleLevels = 4 };  // 1/1, 1/2, 1/4, 1/8
+
+  struct BlobKey {
+    double scaleFactor;
+    cv::Size size;
+    cv::Scalar mean;
+    bool swapRB, crop;
+    int ddepth;
+
+    bool operator==(const BlobKey &_other) const;
+  };
+
+  std::mutex mMutex;
+  std::shared_ptr<void> mLease;
+  JpegBuffer mJpeg;
+  cv::Size mImageSize;
+  cv::Rect mRoi;  // Of the whole image
+  // Whole image scaled by 1 / 2^level, decoded frame has level 0 only
+  cv::Mat mBgrLevels[scaleLevels];
+  cv::Mat mGrayLevels[scaleLevels];
+  // Frame only
+  std::vector<std::pair<cv::Size, cv::Mat>> mBgrViews, mGrayViews;
+  std::vector<std::pair<BlobKey, cv::Mat>> mBlobs;
+
+  // The smallest level, where _window still has _size resolution
+  int levelFor(const cv::Rect &_window, const cv::Size &_size) const;
+  const cv::Mat &level(int _level, bool _gray);
+  // _window of frame at _level scaled to _size
+  cv::Mat scaled(const cv::Mat &_level, int _levelIndex,
+                 const cv::Rect &_window, const cv::Size &_size);
+};
+
+#endif  // FRAMEVIEWS_H
@@ -0,0 +1,131 @@
+#include "jpegdecoder.h"
+
+#ifdef HAVE_LIBJPEG
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+// Color space extensions are of libjpeg-turbo, IJG libjpeg gives RGB only
+#ifndef JCS_EXTENSIONS
+#include <opencv2/imgproc.hpp>
+#endif
+#else
+#include <opencv2/imgcodecs.hpp>
+#endif
+
+using namespace cv;
+using namespace std;
+
+#ifdef HAVE_LIBJPEG
+namespace {
+
+struct ErrorManager {
+  jpeg_error_mgr pub;  // Must be first
+  jmp_buf jump;
+};
+
+void errorExit(j_common_ptr _cinfo) {
+  longjmp(reinterpret_cast<ErrorManager *>(_cinfo->err)->jump, 1);
+}
+
+// Warnings about corrupt data are frequent with cameras, they are counted by
+// libjpeg and not printed
+void outputMessage(j_common_ptr) {}
+
+}  // namespace
+#endif
+
+bool JpegDecoder::readSize(const vector<unsigned char> &_jpeg, Size &_size) {
+  const unsigned char *p = _jpeg.data();
+  size_t n = _jpeg.size();
+
+  if (n < 4 || p[0] != 0xff || p[1] != 0xd8) return false;
+
+  // Segments up to the start of frame marker
+  for (size_t i = 2; i + 9 < n;) {
+    if (p[i] != 0xff) return false;
+
+    unsigned char marker = p[i + 1];
+    size_t length = (p[i + 2] << 8) | p[i + 3];
+
+    // SOF0..SOF15, except DHT, JPG and DAC
+    if (marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 &&
+        marker != 0xcc) {
+      _size = Size((p[i + 7] << 8) | p[i + 8], (p[i + 5] << 8) | p[i + 6]);
+      return _size.width > 0 && _size.height > 0;
+    }
+
+    i += 2 + length;
+  }
+
+  return false;
+}
+
+bool JpegDecoder::decode(const vector<unsigned char> &_jpeg, int _scaleDenom,
+                         bool _gray, Mat &_out) {
+#ifdef HAVE_LIBJPEG
+  // No objects with destructors may live here, longjmp skips them
+  jpeg_decompress_struct cinfo;
+  ErrorManager err;
+
+  cinfo.err = jpeg_std_error(&err.pub);
+  err.pub.error_exit = errorExit;
+  err.pub.output_message = outputMessage;
+
+  if (setjmp(err.jump)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, _jpeg.data(), _jpeg.size());
+  jpeg_read_header(&cinfo, TRUE);
+
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = _scaleDenom;
+#ifdef JCS_EXTENSIONS
+  cinfo.out_color_space = _gray ? JCS_GRAYSCALE : JCS_EXT_BGR;
+#else
+  cinfo.out_color_space = _gray ? JCS_GRAYSCALE : JCS_RGB;
+#endif
+  cinfo.dct_method = JDCT_ISLOW;
+
+  jpeg_start_decompress(&cinfo);
+
+  _out.create(cinfo.output_height, cinfo.output_width,
+              _gray ? CV_8UC1 : CV_8UC3);
+
+  while (cinfo.output_scanline < cinfo.output_height) {
+    JSAMPROW row = _out.ptr<unsigned char>(cinfo.output_scanline);
+    jpeg_read_scanlines(&cinfo, &row, 1);
+  }
+
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+
+#ifndef JCS_EXTENSIONS
+  if (!_gray) cvtColor(_out, _out, COLOR_RGB2BGR);
+#endif
+
+  return true;
+#else
+  int flags;
+
+  switch (_scaleDenom) {
+    case 2:
+      flags = _gray ? IMREAD_REDUCED_GRAYSCALE_2 : IMREAD_REDUCED_COLOR_2;
+      break;
+    case 4:
+      flags = _gray ? IMREAD_REDUCED_GRAYSCALE_4 : IMREAD_REDUCED_COLOR_4;
+      break;
+    case 8:
+      flags = _gray ? IMREAD_REDUCED_GRAYSCALE_8 : IMREAD_REDUCED_COLOR_8;
+      break;
+    default:
+      flags = _gray ? IMREAD_GRAYSCALE : IMREAD_COLOR;
+  }
+
+  _out = imdecode(_jpeg, flags);
+
+  return !_out.empty();
+#endif
+}
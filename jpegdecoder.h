@@ -0,0 +1,30 @@
+#ifndef JPEGDECODER_H
+#define JPEGDECODER_H
+
+#include <memory>
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+// Compressed frame, shared between capturer and its consumers
+typedef std::shared_ptr<const std::vector<unsigned char>> JpegBuffer;
+
+// Decodes JPEG images with scaling by 1/2, 1/4 or 1/8 in DCT domain and
+// optionally to gray only, which skips chroma entirely. Both are much cheaper
+// than full BGR decode and resize. libjpeg is used if it is found, otherwise
+// reduced modes of cv::imdecode.
+class JpegDecoder {
+ public:
+  // Image size from frame header without decoding, false if it is not JPEG
+  static bool readSize(const std::vector<unsigned char> &_jpeg,
+                       cv::Size &_size);
+
+  // _scaleDenom is 1, 2, 4 or 8. _out is CV_8UC1 if _gray, BGR otherwise,
+  // its size is the image size divided by _scaleDenom and rounded up.
+  static bool decode(const std::vector<unsigned char> &_jpeg, int _scaleDenom,
+                     bool _gray, cv::Mat &_out);
+
+ private:
+  explicit JpegDecoder() {}
+};
+
+#endif  // JPEGDECODER_H
@@ -2,9 +2,17 @@
 #define LAUNCHPARAMS_H
 
 #include <boost/optional.hpp>
+#include <string>
+
+#include "countstore.h"
 
 struct launchParams {
   boost::optional<std::string> configFileName;
+
+  // Query of count store, which is run instead of processing
+  boost::optional<std::string> queryFileName;
+  std::string queryFrom, queryTo;  // "YYYY-MM-DD HH:MM", local time
+  CountFilter queryFilter;
 };
 
 #endif  // LAUNCHPARAMS_H
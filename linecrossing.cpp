@@ -0,0 +1,75 @@
+#include "linecrossing.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+// 1/256 pixel. Coordinates up to 2^20 pixels keep orientation products
+// within 64 bits.
+int64_t toFixed(double _v) { return static_cast<int64_t>(llround(_v * 256.0)); }
+
+int sign(int64_t _v) { return (_v > 0) - (_v < 0); }
+
+// Sign of cross product (b - a) x (c - a)
+int orientation(int64_t _ax, int64_t _ay, int64_t _bx, int64_t _by,
+                int64_t _cx, int64_t _cy) {
+  return sign((_bx - _ax) * (_cy - _ay) - (_by - _ay) * (_cx - _ax));
+}
+
+}  // namespace
+
+LineCrossing::LineCrossing(const vector<pair<Point2d, Point2d>> &_lines) {
+  for (const auto &l : _lines) {
+    mAx.push_back(toFixed(l.first.x));
+    mAy.push_back(toFixed(l.first.y));
+    mBx.push_back(toFixed(l.second.x));
+    mBy.push_back(toFixed(l.second.y));
+
+    mMinX.push_back(std::min(mAx.back(), mBx.back()));
+    mMinY.push_back(std::min(mAy.back(), mBy.back()));
+    mMaxX.push_back(std::max(mAx.back(), mBx.back()));
+    mMaxY.push_back(std::max(mAy.back(), mBy.back()));
+  }
+}
+
+void LineCrossing::find(const Point2d &_beg, const Point2d &_end,
+                        vector<int> &_lines) const {
+  int64_t px = toFixed(_beg.x), py = toFixed(_beg.y);
+  int64_t qx = toFixed(_end.x), qy = toFixed(_end.y);
+
+  int64_t minX = std::min(px, qx), maxX = std::max(px, qx);
+  int64_t minY = std::min(py, qy), maxY = std::max(py, qy);
+
+  // Broad phase: all lines in one branch free pass, overlapping bounding
+  // boxes are compacted to the front
+  int n = size();
+  _lines.resize(n);
+
+  int count = 0;
+  for (int i = 0; i < n; ++i) {
+    _lines[count] = i;
+    count += (mMinX[i] <= maxX) & (mMaxX[i] >= minX) & (mMinY[i] <= maxY) &
+             (mMaxY[i] >= minY);
+  }
+
+  // Narrow phase: endpoints of each segment are not strictly on the same
+  // side of the other one. Collinear segments overlap, because their
+  // bounding boxes do.
+  int kept = 0;
+  for (int k = 0; k < count; ++k) {
+    int i = _lines[k];
+
+    int o1 = orientation(px, py, qx, qy, mAx[i], mAy[i]);
+    int o2 = orientation(px, py, qx, qy, mBx[i], mBy[i]);
+    int o3 = orientation(mAx[i], mAy[i], mBx[i], mBy[i], px, py);
+    int o4 = orientation(mAx[i], mAy[i], mBx[i], mBy[i], qx, qy);
+
+    if (o1 * o2 <= 0 && o3 * o4 <= 0) _lines[kept++] = i;
+  }
+
+  _lines.resize(kept);
+}
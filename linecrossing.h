@@ -0,0 +1,29 @@
+#ifndef LINECROSSING_H
+#define LINECROSSING_H
+
+#include <cstdint>
+#include <opencv2/core/core.hpp>
+#include <utility>
+#include <vector>
+
+// Finds counting lines crossed by a movement segment. Lines are pruned by
+// bounding boxes first, then the rest are tested with exact integer
+// orientation predicates on coordinates rounded to 1/256 pixel.
+class LineCrossing {
+ public:
+  explicit LineCrossing(
+      const std::vector<std::pair<cv::Point2d, cv::Point2d>> &_lines);
+
+  // Indices of lines, which segment _beg-_end crosses or touches, ascending
+  void find(const cv::Point2d &_beg, const cv::Point2d &_end,
+            std::vector<int> &_lines) const;
+
+  size_t size() const { return mAx.size(); }
+
+ private:
+  // Lines in fixed point, structure of arrays
+  std::vector<int64_t> mAx, mAy, mBx, mBy;
+  std::vector<int64_t> mMinX, mMinY, mMaxX, mMaxY;
+};
+
+#endif  // LINECROSSING_H
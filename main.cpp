@@ -10,6 +10,7 @@
 #include <chrono>
 #include <ctime>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <mutex>
 #include <nlohmann/json.hpp>
@@ -18,11 +19,18 @@
 #include <sstream>
 #include <thread>
 
+#include "archiveprocessorfactory.h"
 #include "capturerfactory.h"
+#include "cliprecorderfactory.h"
 #include "crosscounterfactory.h"
+#include "debugrendererfactory.h"
+#include "eventwriterfactory.h"
 #include "launchparams.h"
+#include "mjpegstreamerfactory.h"
 #include "recognizerfactory.h"
+#include "thumbnailwriterfactory.h"
 #include "trackerfactory.h"
+#include "videoencoderfactory.h"
 
 using namespace std;
 using namespace cv;
@@ -37,6 +45,9 @@ namespace expr = boost::log::expressions;
 
 launchParams parseArgs(int argc, char *argv[]);
 json getParamsFromJson(const string &_fn);
+int runQuery(const launchParams &_lp);
+int runArchive(const std::shared_ptr<ArchiveProcessor> &_archive,
+               const json &_config);
 
 int main(int argc, char *argv[]) {
   cout << "Args list:" << endl;
@@ -70,6 +81,8 @@ int main(int argc, char *argv[]) {
 
   launchParams lp = parseArgs(argc, argv);
 
+  if (lp.queryFileName) return runQuery(lp);
+
   cout << "Launch parameters:" << endl;
   cout << "\tConfig file name = "
        << (lp.configFileName ? *lp.configFileName : "<undefined>") << endl;
@@ -78,6 +91,15 @@ int main(int argc, char *argv[]) {
   auto configJson =
       getParamsFromJson(lp.configFileName ? *lp.configFileName : "config.json");
 
+  auto archive = ArchiveProcessorFactory::createArchiveProcessor(
+      configJson.contains("Archive") ? configJson["Archive"] : json(),
+      configJson.contains("Capturer") ? configJson["Capturer"] : json(),
+      configJson.contains("Recognizer") ? configJson["Recognizer"] : json(),
+      configJson.contains("Tracker") ? configJson["Tracker"] : json());
+
+  // Recorded file is counted instead of the live source
+  if (archive) return runArchive(archive, configJson);
+
   auto capturer = CapturerFactory::createCapturer(
       configJson.contains("Capturer") ? configJson["Capturer"] : json());
 
@@ -91,6 +113,43 @@ int main(int argc, char *argv[]) {
       configJson.contains("CrossCounter") ? configJson["CrossCounter"]
                                           : json());
 
+  auto renderer = DebugRendererFactory::createDebugRenderer(
+      configJson.contains("DebugRenderer") ? configJson["DebugRenderer"]
+                                           : json());
+
+  if (cc) cc->setDebugRenderer(renderer);
+
+  auto thumbs = ThumbnailWriterFactory::createThumbnailWriter(
+      configJson.contains("ThumbnailWriter") ? configJson["ThumbnailWriter"]
+                                             : json());
+
+  if (cc) cc->setThumbnailWriter(thumbs);
+
+  // Encoder gets frames from the renderer
+  auto encoder = VideoEncoderFactory::createVideoEncoder(
+      configJson.contains("VideoEncoder") ? configJson["VideoEncoder"] : json(),
+      renderer ? renderer->maxFps() : 0.0);
+
+  if (renderer) renderer->setVideoEncoder(encoder);
+
+  auto streamer = MjpegStreamerFactory::createMjpegStreamer(
+      configJson.contains("MjpegStreamer") ? configJson["MjpegStreamer"]
+                                           : json());
+
+  if (renderer) renderer->setMjpegStreamer(streamer);
+
+  auto clips = ClipRecorderFactory::createClipRecorder(
+      configJson.contains("ClipRecorder") ? configJson["ClipRecorder"]
+                                          : json());
+
+  if (capturer) capturer->setClipRecorder(clips);
+
+  auto writer = EventWriterFactory::createEventWriter(
+      configJson.contains("EventWriter") ? configJson["EventWriter"] : json());
+
+  // Counting continues from totals saved by previous run
+  if (cc && writer) cc->restore(writer->recover());
+
   bool abort = false;
   mutex stateMutex;
 
@@ -158,6 +217,224 @@ int main(int argc, char *argv[]) {
   });
   ccThread.detach();
 
+  // CrossCounter to EventWriter and ClipRecorder thread
+  bool c2wStarted = false, c2wFinished = false;
+  std::thread c2wThread(
+      [cc, writer, clips, &stateMutex, &abort, &c2wStarted, &c2wFinished]() {
+        {
+          std::unique_lock<mutex> lck(stateMutex);
+          c2wStarted = true;
+        }
+
+        if (cc)
+          for (;;) {
+            {
+              std::unique_lock<mutex> lck(stateMutex);
+
+              if (abort) break;
+            }
+
+            auto data = cc->pop();
+
+            if (writer && !data.empty()) writer->push(data);
+            if (clips && !data.empty()) clips->pushEvents(data);
+
+            BOOST_LOG_TRIVIAL(trace)
+                << "CrossCounter-to-EventWriter thread: data has been "
+                   "transferred";
+          }
+
+        BOOST_LOG_TRIVIAL(trace)
+            << "CrossCounter-to-EventWriter thread finished properly";
+
+        {
+          std::unique_lock<mutex> lck(stateMutex);
+          c2wFinished = true;
+        }
+      });
+  c2wThread.detach();
+
+  // EventWriter thread
+  bool writerStarted = false, writerFinished = false;
+  std::thread writerThread(
+      [writer, &stateMutex, &abort, &writerStarted, &writerFinished]() {
+        {
+          std::unique_lock<mutex> lck(stateMutex);
+          writerStarted = true;
+        }
+
+        if (writer) {
+          for (;;) {
+            {
+              std::unique_lock<mutex> lck(stateMutex);
+
+              if (abort) break;
+            }
+
+            writer->doWork();
+          }
+
+          writer->flush();
+        }
+
+        BOOST_LOG_TRIVIAL(trace) << "EventWriter thread finished properly";
+
+        {
+          std::unique_lock<mutex> lck(stateMutex);
+          writerFinished = true;
+        }
+      });
+  writerThread.detach();
+
+  // DebugRenderer thread
+  bool rendererStarted = false, rendererFinished = false;
+  std::thread rendererThread(
+      [renderer, &stateMutex, &abort, &rendererStarted, &rendererFinished]() {
+        {
+          std::unique_lock<mutex> lck(stateMutex);
+          rendererStarted = true;
+        }
+
+        if (renderer)
+          for (;;) {
+            {
+              std::unique_lock<mutex> lck(stateMutex);
+
+              if (abort) break;
+            }
+
+            renderer->doWork();
+          }
+
+        BOOST_LOG_TRIVIAL(trace) << "DebugRenderer thread finished properly";
+
+        {
+          std::unique_lock<mutex> lck(stateMutex);
+          rendererFinished = true;
+        }
+      });
+  rendererThread.detach();
+
+  // VideoEncoder thread
+  bool encoderStarted = false, encoderFinished = false;
+  std::thread encoderThread(
+      [encoder, &stateMutex, &abort, &encoderStarted, &encoderFinished]() {
+        {
+          std::unique_lock<mutex> lck(stateMutex);
+          encoderStarted = true;
+        }
+
+        if (encoder)
+          for (;;) {
+            {
+              std::unique_lock<mutex> lck(stateMutex);
+
+              if (abort) break;
+            }
+
+            encoder->doWork();
+          }
+
+        BOOST_LOG_TRIVIAL(trace) << "VideoEncoder thread finished properly";
+
+        {
+          std::unique_lock<mutex> lck(stateMutex);
+          encoderFinished = true;
+        }
+      });
+  encoderThread.detach();
+
+  // ClipRecorder thread
+  bool clipsStarted = false, clipsFinished = false;
+  std::thread clipsThread(
+      [clips, &stateMutex, &abort, &clipsStarted, &clipsFinished]() {
+        {
+          std::unique_lock<mutex> lck(stateMutex);
+          clipsStarted = true;
+        }
+
+        if (clips)
+          for (;;) {
+            {
+              std::unique_lock<mutex> lck(stateMutex);
+
+              if (abort) break;
+            }
+
+            clips->doWork();
+          }
+
+        BOOST_LOG_TRIVIAL(trace) << "ClipRecorder thread finished properly";
+
+        {
+          std::unique_lock<mutex> lck(stateMutex);
+          clipsFinished = true;
+        }
+      });
+  clipsThread.detach();
+
+  // ThumbnailWriter pool threads
+  size_t thumbsThreads = thumbs ? thumbs->threads() : 1;
+  size_t thumbsStarted = 0, thumbsFinished = 0;
+  for (size_t i = 0; i < thumbsThreads; ++i) {
+    std::thread thumbsThread(
+        [thumbs, &stateMutex, &abort, &thumbsStarted, &thumbsFinished]() {
+          {
+            std::unique_lock<mutex> lck(stateMutex);
+            ++thumbsStarted;
+          }
+
+          if (thumbs)
+            for (;;) {
+              {
+                std::unique_lock<mutex> lck(stateMutex);
+
+                if (abort) break;
+              }
+
+              thumbs->doWork();
+            }
+
+          BOOST_LOG_TRIVIAL(trace)
+              << "ThumbnailWriter thread finished properly";
+
+          {
+            std::unique_lock<mutex> lck(stateMutex);
+            ++thumbsFinished;
+          }
+        });
+    thumbsThread.detach();
+  }
+
+  // MjpegStreamer network thread
+  bool streamerStarted = false, streamerFinished = false;
+  std::thread streamerThread(
+      [streamer, &stateMutex, &abort, &streamerStarted, &streamerFinished]() {
+        {
+          std::unique_lock<mutex> lck(stateMutex);
+          streamerStarted = true;
+        }
+
+        if (streamer)
+          for (;;) {
+            {
+              std::unique_lock<mutex> lck(stateMutex);
+
+              if (abort) break;
+            }
+
+            streamer->doWork();
+          }
+
+        BOOST_LOG_TRIVIAL(trace) << "MjpegStreamer thread finished properly";
+
+        {
+          std::unique_lock<mutex> lck(stateMutex);
+          streamerFinished = true;
+        }
+      });
+  streamerThread.detach();
+
   // Recognizer thread
   bool recognizerStarted = false, recognizerFinished = false;
   std::thread recognizerThread([recognizer, &stateMutex, &abort,
@@ -268,6 +545,10 @@ int main(int argc, char *argv[]) {
               if (abort) break;
             }
 
+            // Live frame is taken only when recognizer is ready for it
+            if (capturer->isLive() && recognizer && !recognizer->waitRoom())
+              continue;
+
             auto data = capturer->pop();
 
             if (recognizer) recognizer->push(std::move(data));
@@ -338,7 +619,12 @@ int main(int argc, char *argv[]) {
     if (t2othersStarted && t2othersFinished && ccStarted && ccFinished &&
         recognizerStarted && recognizerFinished && trackerStarted &&
         trackerFinished && capturerStarted && capturerFinished && c2rStarted &&
-        c2rFinished && r2oStarted && r2oFinished) {
+        c2rFinished && r2oStarted && r2oFinished && c2wStarted &&
+        c2wFinished && writerStarted && writerFinished && rendererStarted &&
+        rendererFinished && encoderStarted && encoderFinished &&
+        streamerStarted && streamerFinished && clipsStarted &&
+        clipsFinished && thumbsStarted == thumbsThreads &&
+        thumbsFinished == thumbsThreads) {
       BOOST_LOG_TRIVIAL(trace) << "All treads has been finished properly";
       break;
     }
@@ -361,6 +647,20 @@ int main(int argc, char *argv[]) {
     BOOST_LOG_TRIVIAL(trace) << "c2rFinished = " << c2rFinished;
     BOOST_LOG_TRIVIAL(trace) << "r2oStarted = " << r2oStarted;
     BOOST_LOG_TRIVIAL(trace) << "r2oFinished = " << r2oFinished;
+    BOOST_LOG_TRIVIAL(trace) << "c2wStarted = " << c2wStarted;
+    BOOST_LOG_TRIVIAL(trace) << "c2wFinished = " << c2wFinished;
+    BOOST_LOG_TRIVIAL(trace) << "writerStarted = " << writerStarted;
+    BOOST_LOG_TRIVIAL(trace) << "writerFinished = " << writerFinished;
+    BOOST_LOG_TRIVIAL(trace) << "rendererStarted = " << rendererStarted;
+    BOOST_LOG_TRIVIAL(trace) << "rendererFinished = " << rendererFinished;
+    BOOST_LOG_TRIVIAL(trace) << "encoderStarted = " << encoderStarted;
+    BOOST_LOG_TRIVIAL(trace) << "encoderFinished = " << encoderFinished;
+    BOOST_LOG_TRIVIAL(trace) << "streamerStarted = " << streamerStarted;
+    BOOST_LOG_TRIVIAL(trace) << "streamerFinished = " << streamerFinished;
+    BOOST_LOG_TRIVIAL(trace) << "clipsStarted = " << clipsStarted;
+    BOOST_LOG_TRIVIAL(trace) << "clipsFinished = " << clipsFinished;
+    BOOST_LOG_TRIVIAL(trace) << "thumbsStarted = " << thumbsStarted;
+    BOOST_LOG_TRIVIAL(trace) << "thumbsFinished = " << thumbsFinished;
   }
 
   return EXIT_SUCCESS;
@@ -386,6 +686,20 @@ launchParams parseArgs(int argc, char *argv[]) {
   desc.add_options()("help,h", "Show help")("config,c", po::value<string>(),
                                             "JSON config file name");
 
+  po::options_description queryDesc("Count store query options");
+  queryDesc.add_options()("query,q", po::value<string>(),
+                          "Print sum of counts from count store file and exit")(
+      "from", po::value<string>()->default_value("1970-01-01 00:00"),
+      "Range begin, \"YYYY-MM-DD HH:MM\" local time")(
+      "to", po::value<string>()->default_value("2100-01-01 00:00"),
+      "Range end (excluded)")("kind", po::value<string>(),
+                               "Event kind: line, enter or exit")(
+      "id", po::value<int>(), "Line or zone number, from 0")(
+      "xdir", po::value<int>(), "Horizontal direction: -1, 0 or 1")(
+      "ydir", po::value<int>(), "Vertical direction: -1, 0 or 1")(
+      "class", po::value<int>(), "Recognized item class, -1 for unknown");
+  desc.add(queryDesc);
+
   po::variables_map vm;
   po::parsed_options parsed =
       po::command_line_parser(argc, argv).options(desc).run();
@@ -401,5 +715,96 @@ launchParams parseArgs(int argc, char *argv[]) {
 
   if (vm.count("config")) lp.configFileName = vm["config"].as<string>();
 
+  if (vm.count("query")) {
+    lp.queryFileName = vm["query"].as<string>();
+    lp.queryFrom = vm["from"].as<string>();
+    lp.queryTo = vm["to"].as<string>();
+
+    if (vm.count("kind")) {
+      auto kind = vm["kind"].as<string>();
+
+      if (kind == "line") {
+        lp.queryFilter.kind = CrossEvent::LINE_CROSS;
+      } else if (kind == "enter") {
+        lp.queryFilter.kind = CrossEvent::ZONE_ENTER;
+      } else if (kind == "exit") {
+        lp.queryFilter.kind = CrossEvent::ZONE_EXIT;
+      } else {
+        cerr << "Unknown event kind \"" << kind
+             << "\", line, enter or exit is expected" << endl;
+        exit(EXIT_FAILURE);
+      }
+    }
+    if (vm.count("id")) lp.queryFilter.id = vm["id"].as<int>();
+    if (vm.count("xdir")) lp.queryFilter.xdir = vm["xdir"].as<int>();
+    if (vm.count("ydir")) lp.queryFilter.ydir = vm["ydir"].as<int>();
+    if (vm.count("class")) lp.queryFilter.itemClass = vm["class"].as<int>();
+  }
+
   return lp;
 }
+
+int runQuery(const launchParams &_lp) {
+#ifdef __unix__
+  // Minutes since epoch of local time string
+  auto toMinute = [](const string &_s, int64_t &_minute) {
+    std::tm tm = {};
+    istringstream ss(_s);
+    ss >> get_time(&tm, "%Y-%m-%d %H:%M");
+    if (ss.fail()) return false;
+
+    tm.tm_isdst = -1;
+    _minute = int64_t(mktime(&tm)) / 60;
+    return true;
+  };
+
+  int64_t from, to;
+  if (!toMinute(_lp.queryFrom, from) || !toMinute(_lp.queryTo, to)) {
+    cerr << "Bad time, \"YYYY-MM-DD HH:MM\" is expected" << endl;
+    return EXIT_FAILURE;
+  }
+
+  CountStore store(*_lp.queryFileName, false);
+  if (!store.isOpen()) {
+    cerr << "Can not open count store " << *_lp.queryFileName << endl;
+    return EXIT_FAILURE;
+  }
+
+  size_t scanned = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  uint64_t sum = store.sum(from, to, _lp.queryFilter, &scanned);
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - t0)
+                .count();
+
+  cout << sum << endl;
+  cerr << scanned << " of " << store.rows() << " rows scanned in " << us
+       << " us" << endl;
+
+  return EXIT_SUCCESS;
+#else
+  cerr << "Count store is not supported on this platform" << endl;
+  return EXIT_FAILURE;
+#endif
+}
+
+int runArchive(const std::shared_ptr<ArchiveProcessor> &_archive,
+               const json &_config) {
+  auto cc = CrossCounterFactory::createCrossCounter(
+      _config.contains("CrossCounter") ? _config["CrossCounter"] : json());
+
+  auto writer = EventWriterFactory::createEventWriter(
+      _config.contains("EventWriter") ? _config["EventWriter"] : json());
+
+  // Counting continues from totals saved by previous run
+  if (cc && writer) cc->restore(writer->recover());
+
+  _archive->setCrossCounter(cc);
+  _archive->setEventWriter(writer);
+
+  bool ok = _archive->run();
+
+  if (writer) writer->flush();
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
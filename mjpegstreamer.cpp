@@ -0,0 +1,233 @@
+#include "mjpegstreamer.h"
+
+#include <boost/log/trivial.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+using namespace cv;
+using namespace std;
+namespace asio = boost::asio;
+using asio::ip::tcp;
+
+namespace {
+
+// Statistics are logged every this number of encoded frames
+const long statisticsPeriod = 1000;
+
+// Longer requests are rejected
+const size_t maxRequestSize = 8192;
+// Client, which does not send request in this time, is disconnected, so it
+// does not hold a place of maxClients
+const int requestTimeoutS = 10;
+
+const string responseHeader =
+    "HTTP/1.0 200 OK\r\n"
+    "Cache-Control: no-cache, no-store\r\n"
+    "Pragma: no-cache\r\n"
+    "Connection: close\r\n"
+    "Content-Type: multipart/x-mixed-replace; boundary=frame\r\n"
+    "\r\n";
+
+const string partEnd = "\r\n";
+
+}  // namespace
+
+class MjpegStreamer::Session : public enable_shared_from_this<Session> {
+ public:
+  Session(MjpegStreamer &_streamer, tcp::socket &&_socket)
+      : mStreamer(_streamer),
+        mSocket(move(_socket)),
+        mRequestTimer(_streamer.mIo),
+        mRequest(maxRequestSize),
+        mStreaming(false),
+        mWriting(false) {}
+
+  // Reads request and answers with stream header
+  void start() {
+    auto self = shared_from_this();
+
+    mRequestTimer.expires_after(chrono::seconds(requestTimeoutS));
+    mRequestTimer.async_wait([self](const boost::system::error_code &_ec) {
+      if (_ec == asio::error::operation_aborted) return;
+
+      BOOST_LOG_TRIVIAL(warning)
+          << "MjpegStreamer: no request from client, it is disconnected";
+      self->close();
+    });
+
+    asio::async_read_until(
+        mSocket, mRequest, "\r\n\r\n",
+        [self](const boost::system::error_code &_ec, size_t) {
+          self->mRequestTimer.cancel();
+
+          if (_ec) {
+            self->close();
+            return;
+          }
+
+          asio::async_write(
+              self->mSocket, asio::buffer(responseHeader),
+              [self](const boost::system::error_code &_ec, size_t) {
+                if (_ec) {
+                  self->close();
+                  return;
+                }
+
+                self->mStreaming = true;
+                ++self->mStreamer.mClients;
+              });
+        });
+  }
+
+  void send(const shared_ptr<const JpegFrame> &_frame) {
+    if (!mStreaming) return;
+
+    if (mWriting) {
+      // Previous frame is still being sent, only the latest one waits
+      if (mPending) ++mStreamer.mSkipped;
+      mPending = _frame;
+      return;
+    }
+
+    write(_frame);
+  }
+
+  void close() {
+    boost::system::error_code ec;
+    mRequestTimer.cancel();
+    mSocket.shutdown(tcp::socket::shutdown_both, ec);
+    mSocket.close(ec);
+
+    if (mStreaming) --mStreamer.mClients;
+    mStreaming = false;
+
+    mStreamer.mSessions.erase(shared_from_this());
+  }
+
+ private:
+  MjpegStreamer &mStreamer;
+  tcp::socket mSocket;
+  asio::steady_timer mRequestTimer;
+  asio::streambuf mRequest;
+  bool mStreaming, mWriting;
+  shared_ptr<const JpegFrame> mSending, mPending;
+
+  void write(const shared_ptr<const JpegFrame> &_frame) {
+    mWriting = true;
+    mSending = _frame;  // Keeps buffer alive while it is being sent
+
+    vector<asio::const_buffer> buffers = {asio::buffer(_frame->header),
+                                          asio::buffer(_frame->data),
+                                          asio::buffer(partEnd)};
+
+    auto self = shared_from_this();
+    asio::async_write(mSocket, buffers,
+                      [self](const boost::system::error_code &_ec, size_t) {
+                        self->mSending.reset();
+
+                        if (_ec) {
+                          self->close();
+                          return;
+                        }
+
+                        if (self->mPending)
+                          self->write(move(self->mPending));
+                        else
+                          self->mWriting = false;
+                      });
+  }
+};
+
+MjpegStreamer::MjpegStreamer(const string &_address, unsigned short _port,
+                             int _jpegQuality, size_t _maxClients,
+                             int _timeoutMs)
+    : mMaxClients(_maxClients),
+      mTimeoutMs(_timeoutMs),
+      mEncodeParams({IMWRITE_JPEG_QUALITY, _jpegQuality}),
+      mAcceptor(mIo),
+      mClients(0),
+      mSkipped(0),
+      mEncoded(0) {
+  boost::system::error_code ec;
+  tcp::endpoint endpoint(asio::ip::make_address(_address, ec), _port);
+
+  if (!ec) mAcceptor.open(endpoint.protocol(), ec);
+  if (!ec) mAcceptor.set_option(tcp::acceptor::reuse_address(true), ec);
+  if (!ec) mAcceptor.bind(endpoint, ec);
+  if (!ec) mAcceptor.listen(asio::socket_base::max_listen_connections, ec);
+
+  if (ec) {
+    BOOST_LOG_TRIVIAL(error) << "MjpegStreamer: can not listen on "
+                             << _address << ":" << _port << ": "
+                             << ec.message();
+
+    // Acceptor may be opened before the failure
+    mAcceptor.close(ec);
+    return;
+  }
+
+  BOOST_LOG_TRIVIAL(info) << "MjpegStreamer: listening on " << _address << ":"
+                          << _port;
+
+  accept();
+}
+
+MjpegStreamer::~MjpegStreamer() {
+  boost::system::error_code ec;
+  mAcceptor.close(ec);
+
+  auto sessions = mSessions;
+  for (auto &s : sessions) s->close();
+}
+
+void MjpegStreamer::push(const Mat &_frame) {
+  if (!hasClients()) return;
+
+  auto frame = make_shared<JpegFrame>();
+
+  if (!imencode(".jpg", _frame, frame->data, mEncodeParams)) {
+    BOOST_LOG_TRIVIAL(error) << "MjpegStreamer: can not encode frame";
+    return;
+  }
+
+  frame->header = "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: " +
+                  to_string(frame->data.size()) + "\r\n\r\n";
+
+  asio::post(mIo, [this, frame]() { broadcast(frame); });
+
+  if (++mEncoded % statisticsPeriod == 0)
+    BOOST_LOG_TRIVIAL(debug) << "MjpegStreamer: " << mEncoded
+                             << " frames encoded, " << mSkipped
+                             << " skipped by slow clients";
+}
+
+void MjpegStreamer::doWork() {
+  if (mIo.stopped()) mIo.restart();
+
+  mIo.run_for(chrono::milliseconds(mTimeoutMs));
+}
+
+void MjpegStreamer::accept() {
+  mAcceptor.async_accept(
+      [this](const boost::system::error_code &_ec, tcp::socket _socket) {
+        if (_ec == asio::error::operation_aborted) return;
+
+        if (!_ec) {
+          if (mSessions.size() < mMaxClients) {
+            auto session = make_shared<Session>(*this, move(_socket));
+            mSessions.insert(session);
+            session->start();
+          } else {
+            BOOST_LOG_TRIVIAL(warning)
+                << "MjpegStreamer: too many clients, connection is rejected";
+          }
+        }
+
+        accept();
+      });
+}
+
+void MjpegStreamer::broadcast(const shared_ptr<const JpegFrame> &_frame) {
+  // Session may be closed and erased while sending
+  auto sessions = mSessions;
+  for (auto &s : sessions) s->send(_frame);
+}
@@ -0,0 +1,59 @@
+#ifndef MJPEGSTREAMER_H
+#define MJPEGSTREAMER_H
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <memory>
+#include <opencv2/core/core.hpp>
+#include <set>
+#include <string>
+#include <vector>
+
+// Serves frames as HTTP MJPEG stream (multipart/x-mixed-replace), any
+// request path is answered with the stream. Every frame is JPEG encoded
+// once, the same buffer is sent to all clients. A client, which is still
+// receiving previous frame, gets only the latest of the new ones, so slow
+// clients skip frames instead of buffering them.
+class MjpegStreamer {
+ public:
+  explicit MjpegStreamer(const std::string &_address, unsigned short _port,
+                         int _jpegQuality, size_t _maxClients,
+                         int _timeoutMs);
+  virtual ~MjpegStreamer();
+
+  // False if the address can not be listened on, the streamer is useless
+  bool isListening() const { return mAcceptor.is_open(); }
+
+  // Producer should not prepare frames, when nobody watches
+  bool hasClients() const { return mClients > 0; }
+
+  // Encodes _frame in the calling thread and sends it to clients
+  void push(const cv::Mat &_frame);
+
+  // Network thread
+  void doWork();
+
+ protected:
+  struct JpegFrame {
+    std::string header;  // Multipart boundary and headers of the part
+    std::vector<unsigned char> data;
+  };
+
+  class Session;
+
+  size_t mMaxClients;
+  int mTimeoutMs;
+  std::vector<int> mEncodeParams;
+
+  boost::asio::io_context mIo;
+  boost::asio::ip::tcp::acceptor mAcceptor;
+  std::set<std::shared_ptr<Session>> mSessions;  // Used by network thread
+  std::atomic<int> mClients;
+  std::atomic<long> mSkipped;
+  long mEncoded;
+
+  void accept();
+  void broadcast(const std::shared_ptr<const JpegFrame> &_frame);
+};
+
+#endif  // MJPEGSTREAMER_H
@@ -0,0 +1,35 @@
+#include "mjpegstreamerfactory.h"
+
+using namespace std;
+using namespace nlohmann;
+
+shared_ptr<MjpegStreamer> MjpegStreamerFactory::createMjpegStreamer(
+    const json &_config) {
+  bool on = _config.contains("on") && _config["on"].is_boolean()
+                ? _config["on"].get<bool>()
+                : false;
+
+  if (!on) return nullptr;
+
+  auto streamer = make_shared<MjpegStreamer>(
+      _config.contains("address") && _config["address"].is_string()
+          ? _config["address"].get<string>()
+          : "127.0.0.1",
+      _config.contains("port") && _config["port"].is_number()
+          ? _config["port"].get<unsigned short>()
+          : 8080,
+      _config.contains("jpegQuality") && _config["jpegQuality"].is_number()
+          ? _config["jpegQuality"].get<int>()
+          : 80,
+      _config.contains("maxClients") && _config["maxClients"].is_number()
+          ? _config["maxClients"].get<size_t>()
+          : 4,
+      _config.contains("waitTimeoutMs") && _config["waitTimeoutMs"].is_number()
+          ? _config["waitTimeoutMs"].get<int>()
+          : 200);
+
+  // Without the listener io_context has no work, its thread would spin
+  if (!streamer->isListening()) return nullptr;
+
+  return streamer;
+}
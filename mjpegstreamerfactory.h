@@ -0,0 +1,20 @@
+#ifndef MJPEGSTREAMERFACTORY_H
+#define MJPEGSTREAMERFACTORY_H
+
+#include <memory>
+#include <nlohmann/json.hpp>
+
+#include "mjpegstreamer.h"
+
+class MjpegStreamerFactory {
+ public:
+  virtual ~MjpegStreamerFactory() {}
+
+  static std::shared_ptr<MjpegStreamer> createMjpegStreamer(
+      const nlohmann::json &_config);
+
+ private:
+  explicit MjpegStreamerFactory() {}
+};
+
+#endif  // MJPEGSTREAMERFACTORY_H
@@ -30,6 +30,17 @@ void Recognizer::push(list<CapturerOutput> &&_input) {
   mHaveInput.notify_all();
 }
 
+bool Recognizer::waitRoom() {
+  unique_lock<mutex> lck(mInputMutex);
+
+  if (mMaxPending < 1) return true;
+
+  if (mInputData.size() >= static_cast<size_t>(mMaxPending))
+    mHaveRoom.wait_for(lck, chrono::milliseconds(mTimeoutMs));
+
+  return mInputData.size() < static_cast<size_t>(mMaxPending);
+}
+
 list<RecognizerOutput> Recognizer::pop() {
   unique_lock<mutex> lck(mOutputMutex);
 
@@ -49,19 +60,22 @@ void Recognizer::doWork() {
       mHaveInput.wait_for(lck, chrono::milliseconds(mTimeoutMs));
 
     inputData = move(mInputData);
+
+    mHaveRoom.notify_all();
   }
 
   bool recognitionDone = false;  // Do recognition only for one frame
 
   for (auto it_d = inputData.begin(); it_d != inputData.end(); ++it_d) {
-    assert(!it_d->frame.empty());
+    assert(it_d->frame);
 
     if (!recognitionDone &&
         timeDiffMs(mLastRec, it_d->timestamp) >= mRecognitionDelayMs) {
       mLastRec = it_d->timestamp;
 
       auto t0 = chrono::system_clock::now();
-      auto r_items = mRecognizer->recognize(it_d->frame);
+      auto r_items =
+          mRecognizer->recognize(*it_d->frame, it_d->arena.get());
       auto dt = chrono::duration_cast<chrono::milliseconds>(
                     chrono::system_clock::now() - t0)
                     .count();
@@ -70,8 +84,10 @@ void Recognizer::doWork() {
 
       unique_lock<mutex> lck(mOutputMutex);
 
-      mOutputData.push_back(RecognizerOutput(
-          move(it_d->frame), move(it_d->timestamp), move(r_items), true));
+      mOutputData.push_back(RecognizerOutput(move(it_d->arena),
+                                             move(it_d->frame),
+                                             move(it_d->timestamp),
+                                             move(r_items), true));
 
       recognitionDone = true;
 
@@ -79,9 +95,9 @@ void Recognizer::doWork() {
     } else {
       unique_lock<mutex> lck(mOutputMutex);
 
-      mOutputData.push_back(RecognizerOutput(move(it_d->frame),
-                                             move(it_d->timestamp),
-                                             list<RecognizedItem>(), false));
+      mOutputData.push_back(RecognizerOutput(
+          move(it_d->arena), move(it_d->frame), move(it_d->timestamp),
+          FrameVector<RecognizedItem>(), false));
 
       BOOST_LOG_TRIVIAL(trace) << "Recognizer: Frame has been peeked";
     }
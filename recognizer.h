@@ -7,30 +7,36 @@
 #include <memory>
 #include <mutex>
 #include <utility>
+#include <vector>
 
 #include "capturer.h"
 #include "recognizers/abstractrecognizer.h"
 
 struct RecognizerOutput {
-  cv::Mat frame;
+  std::shared_ptr<FrameArena> arena;  // Declared first to outlive items
+  std::shared_ptr<FrameViews> frame;
   std::chrono::time_point<std::chrono::system_clock> timestamp;
-  std::list<RecognizedItem> items;
+  FrameVector<RecognizedItem> items;
   bool recognitionDone;
 
   RecognizerOutput() : recognitionDone(false) {}
   RecognizerOutput(
-      const cv::Mat &_frame,
+      const std::shared_ptr<FrameArena> &_arena,
+      const std::shared_ptr<FrameViews> &_frame,
       const std::chrono::time_point<std::chrono::system_clock> &_timestamp,
-      const std::list<RecognizedItem> &_items, bool _recognitionDone)
-      : frame(_frame),
+      const FrameVector<RecognizedItem> &_items, bool _recognitionDone)
+      : arena(_arena),
+        frame(_frame),
         timestamp(_timestamp),
         items(_items),
         recognitionDone(_recognitionDone) {}
   RecognizerOutput(
-      cv::Mat &&_frame,
+      std::shared_ptr<FrameArena> &&_arena,
+      std::shared_ptr<FrameViews> &&_frame,
       std::chrono::time_point<std::chrono::system_clock> &&_timestamp,
-      std::list<RecognizedItem> &&_items, bool _recognitionDone)
-      : frame(std::move(_frame)),
+      FrameVector<RecognizedItem> &&_items, bool _recognitionDone)
+      : arena(std::move(_arena)),
+        frame(std::move(_frame)),
         timestamp(std::move(_timestamp)),
         items(std::move(_items)),
         recognitionDone(_recognitionDone) {}
@@ -39,18 +45,30 @@ struct RecognizerOutput {
 
   RecognizerOutput(const RecognizerOutput &_other) = default;
 
-  RecognizerOutput &operator=(const RecognizerOutput &_other) = default;
+  RecognizerOutput &operator=(const RecognizerOutput &_other) {
+    // Copy of items is made on the heap, it does not depend on arena
+    items = FrameVector<RecognizedItem>(_other.items);
+    arena = _other.arena;
+    frame = _other.frame;
+    timestamp = _other.timestamp;
+    recognitionDone = _other.recognitionDone;
+
+    return *this;
+  }
 
   RecognizerOutput(RecognizerOutput &&_other) noexcept
-      : frame(std::move(_other.frame)),
+      : arena(std::move(_other.arena)),
+        frame(std::move(_other.frame)),
         timestamp(std::move(_other.timestamp)),
         items(std::move(_other.items)),
         recognitionDone(std::exchange(_other.recognitionDone, false)) {}
 
   RecognizerOutput &operator=(RecognizerOutput &&_other) noexcept {
+    // Items take memory of the new arena before the old one is released
+    items = std::move(_other.items);
+    arena = std::move(_other.arena);
     frame = std::move(_other.frame);
     timestamp = std::move(_other.timestamp);
-    items = std::move(_other.items);
     recognitionDone = std::exchange(_other.recognitionDone, false);
 
     return *this;
@@ -65,6 +83,12 @@ class Recognizer {
   void push(const std::list<CapturerOutput> &_input);
   void push(std::list<CapturerOutput> &&_input);
 
+  // Waits until less than _maxPending frames are waiting for recognizer,
+  // false on timeout. Live capturer is asked for a frame only then.
+  bool waitRoom();
+
+  int recognitionDelayMs() const { return mRecognitionDelayMs; }
+
   std::list<RecognizerOutput> pop();
 
   void doWork();
@@ -73,7 +97,7 @@ class Recognizer {
   std::list<CapturerOutput> mInputData;
   std::list<RecognizerOutput> mOutputData;
   std::mutex mInputMutex, mOutputMutex;
-  std::condition_variable mHaveInput, mHaveOutput;
+  std::condition_variable mHaveInput, mHaveOutput, mHaveRoom;
 
   std::unique_ptr<AbstractRecognizer> mRecognizer;
   int mRecognitionDelayMs;
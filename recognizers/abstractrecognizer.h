@@ -1,9 +1,12 @@
 #ifndef RECOGNIZERS_ABSTRACTRECOGNIZER_H
 #define RECOGNIZERS_ABSTRACTRECOGNIZER_H
 
-#include <list>
 #include <opencv2/opencv.hpp>
 #include <utility>
+#include <vector>
+
+#include "framearena.h"
+#include "frameviews.h"
 
 struct RecognizedItem {
   int type;
@@ -39,7 +42,10 @@ class AbstractRecognizer {
   explicit AbstractRecognizer() {}
   virtual ~AbstractRecognizer() {}
 
-  virtual std::list<RecognizedItem> recognize(const cv::Mat& _frame) = 0;
+  // Items are allocated in _arena (heap if nullptr). Views of _frame are
+  // shared with other stages.
+  virtual FrameVector<RecognizedItem> recognize(FrameViews& _frame,
+                                                FrameArena* _arena) = 0;
 };
 
 #endif  // RECOGNIZERS_ABSTRACTRECOGNIZER_H
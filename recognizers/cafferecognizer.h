@@ -14,7 +14,8 @@ class CaffeRecognizer : public AbstractRecognizer {
                            const cv::Scalar &_mean, bool _swapRB, bool _crop,
                            int _ddepth);
 
-  virtual std::list<RecognizedItem> recognize(const cv::Mat &_frame) override;
+  virtual FrameVector<RecognizedItem> recognize(FrameViews &_frame,
+                                                FrameArena *_arena) override;
 
  protected:
   double mScaleFactor;
@@ -0,0 +1,295 @@
+// Archive counted by one segment and by 8 parallel segments gives the same
+// events: time, track id and total. Cars of a synthetic scene cross vertical
+// lines, the frame index is drawn into the frames of a MJPEG file, so fake
+// recognizer and tracker know positions of cars exactly. Real Recognizer
+// keeps recognition schedule, real Tracker with HunVerifier numbers tracks,
+// so stitching of segments and overlap choice are checked.
+#include <algorithm>
+#include <boost/log/core.hpp>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+#include <random>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "archiveprocessor.h"
+#include "tests/check.h"
+#include "verifiers/hunverifier.h"
+
+using namespace cv;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+const char *const fileName = "archivetest.avi";
+const Size frameSize(320, 240);
+const int framesCount = 1000;
+const double fps = 25.0;
+// Every 7th frame, so overlaps do not start on recognized frames by chance
+const int recognitionDelayMs = 280;
+// Bits of frame index, drawn as white or black squares along the top
+const int indexBits = 11, bitSize = 16;
+const Size carSize(50, 30);
+// Cars, which are seen less, are not recognized
+const int minVisibleWidth = 10;
+// Every car crosses the middle line. The entry line is crossed by a car,
+// while it appears, so it is counted only if it is recognized early enough:
+// these events depend on recognition schedule.
+const double middleX = 160.0, entryX = 10.0;
+
+struct Car {
+  int first;  // Frame, where the car enters from the left
+  int lane;
+  double speed;  // Pixels per frame
+
+  Rect2d box(int _frame) const {
+    Rect2d r(-carSize.width + speed * (_frame - first), 40.0 + 45.0 * lane,
+             carSize.width, carSize.height);
+
+    return r & Rect2d(0, 0, frameSize.width, frameSize.height);
+  }
+
+  bool visible(int _frame) const {
+    return _frame >= first && box(_frame).width >= minVisibleWidth;
+  }
+};
+
+// Every lane has its own speed, so cars of a lane never overlap
+vector<Car> scene() {
+  const double speeds[] = {2.0, 3.0, 4.5, 6.0};
+  mt19937 rng(1);
+  uniform_int_distribution<int> gap(0, 40);
+  vector<Car> cars;
+
+  for (int lane = 0; lane < 4; ++lane)
+    for (int first = gap(rng); first < framesCount;
+         first += static_cast<int>(2 * carSize.width / speeds[lane]) + gap(rng))
+      cars.push_back(Car{first, lane, speeds[lane]});
+
+  return cars;
+}
+
+int frameIndex(FrameViews &_frame) {
+  Mat bgr = _frame.bgr();
+  int index = 0;
+
+  for (int b = 0; b < indexBits; ++b)
+    if (bgr.at<Vec3b>(bitSize / 2, b * bitSize + bitSize / 2)[1] > 128)
+      index |= 1 << b;
+
+  return index;
+}
+
+bool writeFile() {
+  VideoWriter writer(fileName, CAP_OPENCV_MJPEG,
+                     VideoWriter::fourcc('M', 'J', 'P', 'G'), fps, frameSize);
+
+  if (!writer.isOpened()) return false;
+
+  for (int i = 0; i < framesCount; ++i) {
+    Mat frame(frameSize, CV_8UC3, Scalar::all(0));
+
+    for (int b = 0; b < indexBits; ++b)
+      if (i & (1 << b))
+        rectangle(frame, Rect(b * bitSize, 0, bitSize, bitSize),
+                  Scalar::all(255), FILLED);
+
+    writer.write(frame);
+  }
+
+  return true;
+}
+
+class SceneRecognizer : public AbstractRecognizer {
+ public:
+  explicit SceneRecognizer(const vector<Car> &_cars) : mCars(_cars) {}
+
+  FrameVector<RecognizedItem> recognize(FrameViews &_frame,
+                                        FrameArena *_arena) override {
+    int index = frameIndex(_frame);
+    FrameVector<RecognizedItem> items(_arena);
+
+    for (const auto &c : mCars)
+      if (c.visible(index))
+        items.push_back(RecognizedItem(7, 0.9, c.box(index)));
+
+    return items;
+  }
+
+ private:
+  const vector<Car> &mCars;
+};
+
+// Follows cars, which it was reset with, until they leave the frame
+class SceneTracker : public AbstractTracker {
+ public:
+  explicit SceneTracker(const vector<Car> &_cars) : mCars(_cars) {}
+
+  const FrameVector<TrackedItem> &track(
+      FrameViews &_frame,
+      const time_point<system_clock> &_timestamp) override {
+    int index = frameIndex(_frame);
+    FrameVector<TrackedItem> items;
+
+    for (const auto &item : mItems) {
+      const Car &c = mCars[mTrackCars.at(item.trackId)];
+
+      if (!c.visible(index)) continue;
+
+      items.push_back(item);
+      items.back().rect = c.box(index);
+      items.back().resetRecognized();
+    }
+
+    mItems.swap(items);
+
+    return mItems;
+  }
+
+  void reset(FrameViews &_frame,
+             const FrameVector<TrackedItem> &_items) override {
+    int index = frameIndex(_frame);
+
+    mItems.assign(_items.begin(), _items.end());
+
+    for (const auto &item : mItems) {
+      auto it = find_if(mCars.begin(), mCars.end(), [&](const Car &_c) {
+        return _c.visible(index) && _c.box(index) == item.rect;
+      });
+
+      CHECK(it != mCars.end());
+      if (it != mCars.end()) mTrackCars[item.trackId] = it - mCars.begin();
+    }
+  }
+
+ private:
+  const vector<Car> &mCars;
+  FrameVector<TrackedItem> mItems;
+  unordered_map<int, size_t> mTrackCars;  // Track id -> car
+};
+
+class RecordingSink : public AbstractEventSink {
+ public:
+  explicit RecordingSink(vector<CrossEvent> &_events) : mEvents(_events) {}
+
+  bool write(const vector<CrossEvent> &_events) override {
+    mEvents.insert(mEvents.end(), _events.begin(), _events.end());
+    return true;
+  }
+
+ private:
+  vector<CrossEvent> &mEvents;
+};
+
+class TestProcessor : public ArchiveProcessor {
+ public:
+  TestProcessor(int _segments, const vector<Car> &_cars)
+      : ArchiveProcessor(fileName, _segments, 2000, 0.3, Rect2d(), 64 * 1024,
+                         [&_cars]() {
+                           return Chain{
+                               make_shared<Recognizer>(
+                                   unique_ptr<AbstractRecognizer>(
+                                       new SceneRecognizer(_cars)),
+                                   recognitionDelayMs, 0, 10),
+                               make_shared<Tracker>(
+                                   unique_ptr<AbstractTracker>(
+                                       new SceneTracker(_cars)),
+                                   unique_ptr<AbstractVerifier>(
+                                       new HunVerifier(0.3, 2)),
+                                   [](const RecognizedItem &) { return true; },
+                                   [](const RecognizedItem &) { return true; },
+                                   0, 10)};
+                         }) {}
+
+  // Frame of event, timestamps are relative to the start of the run
+  int frameOf(const time_point<system_clock> &_timestamp) const {
+    return static_cast<int>(
+        lround(duration<double>(_timestamp - mStart).count() * mFps));
+  }
+};
+
+// Line crossings as (frame, line, track id, total)
+vector<tuple<int, int, int, int>> countArchive(int _segments,
+                                               const vector<Car> &_cars) {
+  vector<CrossEvent> events;
+  vector<unique_ptr<AbstractEventSink>> sinks;
+  sinks.emplace_back(new RecordingSink(events));
+
+  // Queue is smaller than events of a segment, nothing must be dropped
+  auto writer = make_shared<EventWriter>(move(sinks), 16, 8, 1000, 10);
+  TestProcessor processor(_segments, _cars);
+
+  processor.setCrossCounter(make_shared<CrossCounter>(
+      vector<pair<Point2d, Point2d>>{
+          make_pair(Point2d(middleX, 0.0), Point2d(middleX, frameSize.height)),
+          make_pair(Point2d(entryX, 0.0), Point2d(entryX, frameSize.height))},
+      vector<vector<Point2d>>(), 4, 10));
+  processor.setEventWriter(writer);
+
+  CHECK(processor.run());
+  writer->flush();
+
+  CHECK(writer->dropped() == 0);
+  CHECK(writer->lost() == 0);
+
+  vector<tuple<int, int, int, int>> crossings;
+
+  for (const auto &e : events)
+    crossings.push_back(make_tuple(processor.frameOf(e.timestamp), e.line_id,
+                                   e.track_id, e.crosses));
+
+  sort(crossings.begin(), crossings.end());
+
+  return crossings;
+}
+
+}  // namespace
+
+int main() {
+  boost::log::core::get()->set_logging_enabled(false);
+
+  if (!writeFile()) {
+    CHECK(!"MJPEG file can be written");
+    return checkResult();
+  }
+
+  vector<Car> cars = scene();
+  // Cars, which center passes the middle line within the file
+  long crossing = count_if(cars.begin(), cars.end(), [](const Car &_c) {
+    return _c.first + (middleX + carSize.width / 2.0) / _c.speed <
+           framesCount - 1;
+  });
+
+  auto sequential = countArchive(1, cars);
+  auto parallel = countArchive(8, cars);
+
+  auto onLine = [](const vector<tuple<int, int, int, int>> &_crossings,
+                   int _line) {
+    return count_if(_crossings.begin(), _crossings.end(),
+                    [_line](const tuple<int, int, int, int> &_c) {
+                      return get<1>(_c) == _line;
+                    });
+  };
+
+  printf("%d cars, %ld cross the middle line. Sequentially: %ld middle, %ld "
+         "entry crossings. By 8 segments: %ld middle, %ld entry crossings\n",
+         static_cast<int>(cars.size()), crossing,
+         static_cast<long>(onLine(sequential, 0)),
+         static_cast<long>(onLine(sequential, 1)),
+         static_cast<long>(onLine(parallel, 0)),
+         static_cast<long>(onLine(parallel, 1)));
+
+  CHECK(onLine(sequential, 0) == crossing);
+  // Some cars are seen too late to count their entry
+  CHECK(onLine(sequential, 1) > 0 && onLine(sequential, 1) < crossing);
+  CHECK(sequential == parallel);
+
+  remove(fileName);
+
+  return checkResult();
+}
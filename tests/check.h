@@ -0,0 +1,24 @@
+#ifndef TESTS_CHECK_H
+#define TESTS_CHECK_H
+
+#include <cstdlib>
+#include <iostream>
+
+// Failed check is reported, the test goes on and fails at the end
+#define CHECK(_condition)                                              \
+  do {                                                                 \
+    if (!(_condition)) {                                               \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " << #_condition \
+                << " failed" << std::endl;                             \
+      checkFailed() = true;                                            \
+    }                                                                  \
+  } while (false)
+
+inline bool &checkFailed() {
+  static bool failed = false;
+  return failed;
+}
+
+inline int checkResult() { return checkFailed() ? EXIT_FAILURE : EXIT_SUCCESS; }
+
+#endif  // TESTS_CHECK_H
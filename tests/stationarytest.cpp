@@ -0,0 +1,62 @@
+// Still object is frozen after stationaryFrames frames, stays frozen while it
+// does not move and is unfrozen when it moves
+#include <chrono>
+#include <opencv2/imgproc.hpp>
+
+#include "frameviews.h"
+#include "tests/check.h"
+#include "trackers/cvtracker.h"
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+class TestTracker : public CvTracker {
+ public:
+  TestTracker()
+      : CvTracker([]() { return TrackerKCF::create(); }, 320, 240, 0.5, 0,
+                  1.0, 3, 8.0) {}
+
+  size_t slots() const { return mSlots.size(); }
+  bool frozen() const { return !mSlots.empty() && mSlots.front().frozen; }
+};
+
+// Textured box on a flat background
+Mat scene(int _x) {
+  Mat frame(480, 640, CV_8UC3, Scalar(40, 40, 40));
+  rectangle(frame, Rect(_x, 200, 80, 60), Scalar(200, 180, 160), FILLED);
+  rectangle(frame, Rect(_x + 20, 215, 30, 20), Scalar(60, 90, 120), FILLED);
+  line(frame, Point(_x, 200), Point(_x + 80, 260), Scalar(250, 250, 250), 3);
+
+  return frame;
+}
+
+}  // namespace
+
+int main() {
+  TestTracker tracker;
+  auto ts = chrono::system_clock::now();
+
+  FrameViews first(scene(100));
+  FrameVector<TrackedItem> items;
+  items.push_back(TrackedItem(0, 1, 1.0, Rect2d(100, 200, 80, 60), 0));
+  tracker.reset(first, items);
+
+  // Frozen on the third still frame and stays frozen
+  for (int i = 1; i <= 10; ++i) {
+    FrameViews frame(scene(100));
+    tracker.track(frame, ts + chrono::milliseconds(40 * i));
+
+    CHECK(tracker.slots() == 1);
+    CHECK(tracker.frozen() == (i >= 3));
+  }
+
+  // Motion resumes
+  FrameViews moved(scene(130));
+  tracker.track(moved, ts + chrono::milliseconds(440));
+
+  CHECK(!tracker.frozen());
+
+  return checkResult();
+}
@@ -0,0 +1,121 @@
+#include "thumbnailwriter.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <cstdio>
+#include <ctime>
+#include <opencv2/imgcodecs.hpp>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+// Statistics are logged every this number of written files
+const long statisticsPeriod = 100;
+
+}  // namespace
+
+ThumbnailWriter::ThumbnailWriter(const string &_dir, int _jpegQuality,
+                                 size_t _threads, size_t _queueSize,
+                                 int _timeoutMs)
+    : mDir(_dir),
+      mJpegQuality(std::min(std::max(_jpegQuality, 1), 100)),
+      mThreads(std::max<size_t>(_threads, 1)),
+      mQueueSize(std::max<size_t>(_queueSize, 1)),
+      mTimeoutMs(_timeoutMs),
+      mWritten(0),
+      mDropped(0),
+      mTmpCounter(0) {}
+
+ThumbnailWriter::~ThumbnailWriter() {}
+
+string ThumbnailWriter::fileName(
+    int _trackId, const time_point<system_clock> &_timestamp) const {
+  time_t t = system_clock::to_time_t(_timestamp);
+  auto local = *localtime(&t);
+  char stamp[32];
+  strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &local);
+
+  string name =
+      string("thumb_") + stamp + "_" + to_string(_trackId) + ".jpg";
+
+  return mDir.empty() ? name : mDir + "/" + name;
+}
+
+void ThumbnailWriter::push(const string &_fileName, const Mat &_crop) {
+  unique_lock<mutex> lck(mMutex);
+
+  for (auto &j : mQueue)
+    if (j.fileName == _fileName) {
+      j.crop = _crop;
+      return;
+    }
+
+  if (mQueue.size() >= mQueueSize) {
+    ++mDropped;
+    BOOST_LOG_TRIVIAL(warning) << "ThumbnailWriter: queue is full, "
+                               << _fileName << " is dropped";
+    return;
+  }
+
+  mQueue.push_back(Job{_fileName, _crop});
+
+  mHaveJob.notify_one();
+}
+
+void ThumbnailWriter::doWork() {
+  Job job;
+  string tmpName;
+
+  {
+    unique_lock<mutex> lck(mMutex);
+
+    auto ready = [this](const Job &_job) {
+      return !mWriting.count(_job.fileName);
+    };
+
+    auto it = find_if(mQueue.begin(), mQueue.end(), ready);
+
+    if (it == mQueue.end()) {
+      mHaveJob.wait_for(lck, milliseconds(mTimeoutMs));
+      it = find_if(mQueue.begin(), mQueue.end(), ready);
+    }
+
+    if (it == mQueue.end()) return;
+
+    job = move(*it);
+    mQueue.erase(it);
+    mWriting.insert(job.fileName);
+    tmpName = job.fileName + ".tmp" + to_string(mTmpCounter++);
+  }
+
+  vector<unsigned char> jpeg;
+  bool ok = imencode(".jpg", job.crop, jpeg,
+                     vector<int>{IMWRITE_JPEG_QUALITY, mJpegQuality});
+
+  if (ok) {
+    FILE *file = fopen(tmpName.c_str(), "wb");
+
+    ok = file && fwrite(jpeg.data(), 1, jpeg.size(), file) == jpeg.size();
+    if (file && fclose(file) != 0) ok = false;
+    if (ok) ok = rename(tmpName.c_str(), job.fileName.c_str()) == 0;
+    if (!ok) remove(tmpName.c_str());
+  }
+
+  if (!ok)
+    BOOST_LOG_TRIVIAL(error) << "ThumbnailWriter: can not write "
+                             << job.fileName;
+
+  unique_lock<mutex> lck(mMutex);
+
+  mWriting.erase(job.fileName);
+  // Job of the same file may wait for this one
+  if (!mQueue.empty()) mHaveJob.notify_one();
+
+  if (ok && ++mWritten % statisticsPeriod == 0)
+    BOOST_LOG_TRIVIAL(debug) << "ThumbnailWriter: " << mWritten
+                             << " files written, " << mDropped << " dropped";
+}
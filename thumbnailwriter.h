@@ -0,0 +1,56 @@
+#ifndef THUMBNAILWRITER_H
+#define THUMBNAILWRITER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <opencv2/core/core.hpp>
+#include <set>
+#include <string>
+
+// Encodes best shots of tracks to JPEG files. doWork() is called by a pool
+// of _threads threads. A file may be pushed again with a better shot, then
+// the queued job is updated in place and jobs of one file are never written
+// concurrently, so the newest shot wins. Files are replaced atomically. If
+// the queue is full, the shot is dropped, so pushing never waits.
+class ThumbnailWriter {
+ public:
+  explicit ThumbnailWriter(const std::string &_dir, int _jpegQuality,
+                           size_t _threads, size_t _queueSize,
+                           int _timeoutMs);
+  virtual ~ThumbnailWriter();
+
+  // File of track, which has the first event at _timestamp
+  std::string fileName(
+      int _trackId,
+      const std::chrono::time_point<std::chrono::system_clock> &_timestamp)
+      const;
+
+  // _crop must not be modified after pushing
+  void push(const std::string &_fileName, const cv::Mat &_crop);
+
+  size_t threads() const { return mThreads; }
+
+  void doWork();
+
+ protected:
+  struct Job {
+    std::string fileName;
+    cv::Mat crop;
+  };
+
+  std::string mDir;
+  int mJpegQuality;
+  size_t mThreads;
+  size_t mQueueSize;
+  int mTimeoutMs;
+
+  std::deque<Job> mQueue;
+  std::set<std::string> mWriting;  // Files, which are being written now
+  long mWritten, mDropped, mTmpCounter;
+  std::mutex mMutex;
+  std::condition_variable mHaveJob;
+};
+
+#endif  // THUMBNAILWRITER_H
@@ -0,0 +1,30 @@
+#include "thumbnailwriterfactory.h"
+
+using namespace std;
+using namespace nlohmann;
+
+shared_ptr<ThumbnailWriter> ThumbnailWriterFactory::createThumbnailWriter(
+    const json &_config) {
+  bool on = _config.contains("on") && _config["on"].is_boolean()
+                ? _config["on"].get<bool>()
+                : false;
+
+  if (!on) return nullptr;
+
+  return shared_ptr<ThumbnailWriter>(new ThumbnailWriter(
+      _config.contains("dir") && _config["dir"].is_string()
+          ? _config["dir"].get<string>()
+          : "",
+      _config.contains("jpegQuality") && _config["jpegQuality"].is_number()
+          ? _config["jpegQuality"].get<int>()
+          : 90,
+      _config.contains("threads") && _config["threads"].is_number()
+          ? _config["threads"].get<size_t>()
+          : 2,
+      _config.contains("queueSize") && _config["queueSize"].is_number()
+          ? _config["queueSize"].get<size_t>()
+          : 64,
+      _config.contains("waitTimeoutMs") && _config["waitTimeoutMs"].is_number()
+          ? _config["waitTimeoutMs"].get<int>()
+          : 200));
+}
@@ -0,0 +1,20 @@
+#ifndef THUMBNAILWRITERFACTORY_H
+#define THUMBNAILWRITERFACTORY_H
+
+#include <memory>
+#include <nlohmann/json.hpp>
+
+#include "thumbnailwriter.h"
+
+class ThumbnailWriterFactory {
+ public:
+  virtual ~ThumbnailWriterFactory() {}
+
+  static std::shared_ptr<ThumbnailWriter> createThumbnailWriter(
+      const nlohmann::json &_config);
+
+ private:
+  explicit ThumbnailWriterFactory() {}
+};
+
+#endif  // THUMBNAILWRITERFACTORY_H
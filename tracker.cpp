@@ -1,10 +1,18 @@
 #include "tracker.h"
 
+#include <algorithm>
 #include <boost/log/trivial.hpp>
 
 using namespace cv;
 using namespace std;
 
+namespace {
+
+// Statistics are logged every this number of seconds
+const int statisticsPeriodS = 60;
+
+}  // namespace
+
 Tracker::Tracker(unique_ptr<AbstractTracker> _tracker,
                  unique_ptr<AbstractVerifier> _verifier,
                  AbstractVerifier::ItemFilterFunction _weakFitFunc,
@@ -16,7 +24,10 @@ Tracker::Tracker(unique_ptr<AbstractTracker> _tracker,
       mStrongFitFunc(move(_strongFitFunc)),
       mMaxPending(_maxPending),
       mTimeoutMs(_timeoutMs),
-      mCounter(0) {}
+      mCounter(0),
+      mFramesCount(0),
+      mInterpolatedCount(0),
+      mLastStatistics(chrono::steady_clock::now()) {}
 
 void Tracker::push(const list<RecognizerOutput> &_input) {
   unique_lock<mutex> lck(mInputMutex);
@@ -55,17 +66,26 @@ void Tracker::doWork() {
     inputData = move(mInputData);
   }
 
-  // Pre-analyze which frames process
-  int peek = (mMaxPending >= 1 && inputData.size() >= 5)
-                 ? inputData.size() / mMaxPending - 1
-                 : 0;
+  // Load shedding: under load only every step-th frame is tracked, others get
+  // extrapolated positions. Recognized frames are never skipped.
+  int step =
+      mMaxPending >= 1 && static_cast<int>(inputData.size()) > mMaxPending
+          ? (inputData.size() + mMaxPending - 1) / mMaxPending
+          : 1;
+
+  int index = 0;
+  for (auto it_d = inputData.begin(); it_d != inputData.end();
+       ++it_d, ++index) {
+    assert(it_d->frame);
 
-  for (auto it_d = inputData.begin(); it_d != inputData.end(); ++it_d) {
-    assert(!it_d->frame.empty());
+    FrameVector<TrackedItem> t_items(it_d->arena.get());
 
     if (it_d->recognitionDone) {
       auto t0 = chrono::system_clock::now();
-      auto t_items = mTracker->track(it_d->frame);
+      const auto &tracked = mTracker->track(*it_d->frame, it_d->timestamp);
+      // Room for new items, so verify does not reallocate
+      t_items.reserve(tracked.size() + it_d->items.size());
+      t_items.assign(tracked.begin(), tracked.end());
       auto dt = chrono::duration_cast<chrono::milliseconds>(
                     chrono::system_clock::now() - t0)
                     .count();
@@ -82,38 +102,98 @@ void Tracker::doWork() {
         if (_item.trackId == -1) _item.trackId = mCounter++;
       });
 
-      mTracker->reset(it_d->frame, t_items);
-
-      unique_lock<mutex> lck(mOutputMutex);
-
-      mOutputData.push_back(TrackerOutput(
-          move(it_d->frame), move(it_d->timestamp), move(t_items)));
+      mTracker->reset(*it_d->frame, t_items);
+      updateMotions(t_items, it_d->timestamp);
 
       BOOST_LOG_TRIVIAL(trace)
           << "Tracker: Frame has been tracked and verified";
-    } else {
+    } else if (index % step == 0 || next(it_d) == inputData.end()) {
       auto t0 = chrono::system_clock::now();
-      auto t_items = mTracker->track(it_d->frame);
+      t_items = mTracker->track(*it_d->frame, it_d->timestamp);
       auto dt = chrono::duration_cast<chrono::milliseconds>(
                     chrono::system_clock::now() - t0)
                     .count();
       BOOST_LOG_TRIVIAL(trace) << "Tracker: Track time = " << dt << " ms";
 
-      mOutputData.push_back(TrackerOutput(
-          move(it_d->frame), move(it_d->timestamp), move(t_items)));
+      updateMotions(t_items, it_d->timestamp);
 
       BOOST_LOG_TRIVIAL(trace) << "Tracker: Frame has been only tracked";
+    } else {
+      interpolate(*it_d->frame, it_d->timestamp, t_items);
+      ++mInterpolatedCount;
+
+      BOOST_LOG_TRIVIAL(trace) << "Tracker: Frame has been interpolated";
     }
 
-    for (int p = 0; p < peek; ++p)
-      if (next(it_d) != inputData.end()) {
-        // TODO: maybe not peek "recognitionDone" frames.
-        ++it_d;
-        BOOST_LOG_TRIVIAL(trace) << "Tracker: Frame has been peeked";
-      } else {
-        break;
-      }
+    ++mFramesCount;
+
+    unique_lock<mutex> lck(mOutputMutex);
+
+    mOutputData.push_back(TrackerOutput(move(it_d->arena), move(it_d->frame),
+                                        move(it_d->timestamp), move(t_items)));
   }
 
+  if (step > 1)
+    BOOST_LOG_TRIVIAL(debug)
+        << "Tracker: " << inputData.size() << " pending frames, "
+        << 100.0 * interpolatedFraction() << "% of all frames interpolated";
+
   mHaveOutput.notify_all();
+
+  auto now = chrono::steady_clock::now();
+  if (now - mLastStatistics >= chrono::seconds(statisticsPeriodS)) {
+    mLastStatistics = now;
+
+    BOOST_LOG_TRIVIAL(info)
+        << "Tracker: " << mFramesCount << " frames, "
+        << 100.0 * interpolatedFraction() << "% interpolated";
+  }
+}
+
+double Tracker::interpolatedFraction() const {
+  long frames = mFramesCount;
+
+  return frames > 0 ? static_cast<double>(mInterpolatedCount) / frames : 0.0;
+}
+
+void Tracker::interpolate(
+    const FrameViews &_frame,
+    const chrono::time_point<chrono::system_clock> &_timestamp,
+    FrameVector<TrackedItem> &_items) {
+  _items.clear();
+  _items.reserve(mLastItems.size());
+
+  for (const auto &item : mLastItems) {
+    auto it_m = mMotions.find(item.trackId);
+
+    if (it_m == mMotions.end()) continue;
+
+    TrackedItem i(item);
+    i.rect = it_m->second.predict(_timestamp) &
+             Rect2d(0, 0, _frame.cols(), _frame.rows());
+    i.resetRecognized();
+
+    if (!i.rect.empty()) _items.push_back(i);
+  }
+}
+
+void Tracker::updateMotions(
+    const FrameVector<TrackedItem> &_items,
+    const chrono::time_point<chrono::system_clock> &_timestamp) {
+  // Models are updated in place, only new tracks insert into the map
+  for (const auto &item : _items)
+    mMotions[item.trackId].update(item.rect, _timestamp);
+
+  mLastIds.clear();
+  for (const auto &item : _items) mLastIds.push_back(item.trackId);
+  sort(mLastIds.begin(), mLastIds.end());
+
+  // Forget lost tracks
+  for (auto it_m = mMotions.begin(); it_m != mMotions.end();)
+    if (binary_search(mLastIds.begin(), mLastIds.end(), it_m->first))
+      ++it_m;
+    else
+      it_m = mMotions.erase(it_m);
+
+  mLastItems = _items;
 }
@@ -1,33 +1,41 @@
 #ifndef TRACKER_H
 #define TRACKER_H
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <list>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "recognizer.h"
 #include "recognizers/abstractrecognizer.h"
 #include "trackers/abstracttracker.h"
+#include "trackers/motionmodel.h"
 #include "verifiers/abstractverifier.h"
 
 struct TrackerOutput {
-  cv::Mat frame;
+  std::shared_ptr<FrameArena> arena;  // Declared first to outlive items
+  std::shared_ptr<FrameViews> frame;
   std::chrono::time_point<std::chrono::system_clock> timestamp;
-  std::list<TrackedItem> items;
+  FrameVector<TrackedItem> items;
 
   TrackerOutput() {}
   TrackerOutput(
-      const cv::Mat &_frame,
+      const std::shared_ptr<FrameArena> &_arena,
+      const std::shared_ptr<FrameViews> &_frame,
       const std::chrono::time_point<std::chrono::system_clock> &_timestamp,
-      const std::list<TrackedItem> &_items)
-      : frame(_frame), timestamp(_timestamp), items(_items) {}
-  TrackerOutput(cv::Mat &&_frame,
+      const FrameVector<TrackedItem> &_items)
+      : arena(_arena), frame(_frame), timestamp(_timestamp), items(_items) {}
+  TrackerOutput(std::shared_ptr<FrameArena> &&_arena,
+                std::shared_ptr<FrameViews> &&_frame,
                 std::chrono::time_point<std::chrono::system_clock> &&_timestamp,
-                std::list<TrackedItem> &&_items)
-      : frame(std::move(_frame)),
+                FrameVector<TrackedItem> &&_items)
+      : arena(std::move(_arena)),
+        frame(std::move(_frame)),
         timestamp(std::move(_timestamp)),
         items(std::move(_items)) {}
 
@@ -35,17 +43,28 @@ struct TrackerOutput {
 
   TrackerOutput(const TrackerOutput &_other) = default;
 
-  TrackerOutput &operator=(const TrackerOutput &_other) = default;
+  TrackerOutput &operator=(const TrackerOutput &_other) {
+    // Copy of items is made on the heap, it does not depend on arena
+    items = FrameVector<TrackedItem>(_other.items);
+    arena = _other.arena;
+    frame = _other.frame;
+    timestamp = _other.timestamp;
+
+    return *this;
+  }
 
   TrackerOutput(TrackerOutput &&_other) noexcept
-      : frame(std::move(_other.frame)),
+      : arena(std::move(_other.arena)),
+        frame(std::move(_other.frame)),
         timestamp(std::move(_other.timestamp)),
         items(std::move(_other.items)) {}
 
   TrackerOutput &operator=(TrackerOutput &&_other) noexcept {
+    // Items take memory of the new arena before the old one is released
+    items = std::move(_other.items);
+    arena = std::move(_other.arena);
     frame = std::move(_other.frame);
     timestamp = std::move(_other.timestamp);
-    items = std::move(_other.items);
 
     return *this;
   }
@@ -66,6 +85,10 @@ class Tracker {
 
   void doWork();
 
+  // Share of frames interpolated under load since start, safe to call from
+  // any thread
+  double interpolatedFraction() const;
+
  protected:
   std::list<RecognizerOutput> mInputData;
   std::list<TrackerOutput> mOutputData;
@@ -80,6 +103,21 @@ class Tracker {
   int mMaxPending;
   int mTimeoutMs;
   int mCounter;
+
+  // Motion of every track, to extrapolate it on frames skipped under load
+  std::unordered_map<int, MotionModel> mMotions;
+  FrameVector<TrackedItem> mLastItems;
+  std::vector<int> mLastIds;  // Sorted track ids of mLastItems
+  std::atomic<long> mFramesCount, mInterpolatedCount;
+  std::chrono::time_point<std::chrono::steady_clock> mLastStatistics;
+
+  void interpolate(
+      const FrameViews &_frame,
+      const std::chrono::time_point<std::chrono::system_clock> &_timestamp,
+      FrameVector<TrackedItem> &_items);
+  void updateMotions(
+      const FrameVector<TrackedItem> &_items,
+      const std::chrono::time_point<std::chrono::system_clock> &_timestamp);
 };
 
 #endif  // TRACKER_H
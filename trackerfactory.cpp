@@ -4,6 +4,7 @@
 #include <memory>
 
 #include "recognizers/abstractrecognizer.h"
+#include "trackers/budgettracker.h"
 #include "trackers/cvtracker.h"
 #include "verifiers/hunverifier.h"
 
@@ -47,6 +48,27 @@ unique_ptr<AbstractTracker> TrackerFactory::createInternalTracker(
       _config.contains("frameHeight") && _config["frameHeight"].is_number()
           ? _config["frameHeight"].get<int>()
           : 150;
+  double reinitIouThreshold = _config.contains("reinitIouThreshold") &&
+                                      _config["reinitIouThreshold"].is_number()
+                                  ? _config["reinitIouThreshold"].get<double>()
+                                  : 0.7;
+  int cropTargetSize = _config.contains("cropTargetSize") &&
+                               _config["cropTargetSize"].is_number()
+                           ? _config["cropTargetSize"].get<int>()
+                           : 0;
+  double cropSearchFactor = _config.contains("cropSearchFactor") &&
+                                    _config["cropSearchFactor"].is_number()
+                                ? _config["cropSearchFactor"].get<double>()
+                                : 2.5;
+  int stationaryFrames = _config.contains("stationaryFrames") &&
+                                 _config["stationaryFrames"].is_number()
+                             ? _config["stationaryFrames"].get<int>()
+                             : 0;
+  double stationaryThreshold =
+      _config.contains("stationaryThreshold") &&
+              _config["stationaryThreshold"].is_number()
+          ? _config["stationaryThreshold"].get<double>()
+          : 6.0;
 
   if (_config.contains("typeName") && _config["typeName"].is_string()) {
     auto name = _config["typeName"].get<string>();
@@ -59,13 +81,65 @@ unique_ptr<AbstractTracker> TrackerFactory::createInternalTracker(
         if (cvname == "KCF")
           return unique_ptr<AbstractTracker>(
               new CvTracker([]() { return cv::TrackerKCF::create(); },
-                            frameWidth, frameHeight));
+                            frameWidth, frameHeight, reinitIouThreshold,
+                            cropTargetSize, cropSearchFactor,
+                            stationaryFrames, stationaryThreshold));
       }
+    } else if (name == "BudgetTracker") {
+      vector<CvTracker::CvTrackerCreateFunction> createFuncs;
+
+      if (_config.contains("algorithms") && _config["algorithms"].is_array())
+        for (json::const_iterator it = _config["algorithms"].begin();
+             it != _config["algorithms"].end(); ++it)
+          if (it->is_string()) {
+            auto cvname = it->get<string>();
+
+            if (cvname == "CSRT")
+              createFuncs.push_back([]() { return cv::TrackerCSRT::create(); });
+            else if (cvname == "KCF")
+              createFuncs.push_back([]() { return cv::TrackerKCF::create(); });
+            else if (cvname == "MOSSE")
+              createFuncs.push_back(
+                  []() { return cv::TrackerMOSSE::create(); });
+          }
+
+      if (createFuncs.empty())
+        createFuncs = {[]() { return cv::TrackerCSRT::create(); },
+                       []() { return cv::TrackerKCF::create(); },
+                       []() { return cv::TrackerMOSSE::create(); }};
+
+      vector<pair<cv::Point2d, cv::Point2d>> priorityLines;
+
+      if (_config.contains("priorityLines") &&
+          _config["priorityLines"].is_array())
+        for (json::const_iterator it = _config["priorityLines"].begin();
+             it != _config["priorityLines"].end(); ++it)
+          if (it->contains("begX") && (*it)["begX"].is_number() &&
+              it->contains("begY") && (*it)["begY"].is_number() &&
+              it->contains("endX") && (*it)["endX"].is_number() &&
+              it->contains("endY") && (*it)["endY"].is_number())
+            priorityLines.push_back(make_pair(
+                cv::Point2d((*it)["begX"].get<double>(),
+                            (*it)["begY"].get<double>()),
+                cv::Point2d((*it)["endX"].get<double>(),
+                            (*it)["endY"].get<double>())));
+
+      return unique_ptr<AbstractTracker>(new BudgetTracker(
+          createFuncs, frameWidth, frameHeight, reinitIouThreshold,
+          cropTargetSize, cropSearchFactor, stationaryFrames,
+          stationaryThreshold,
+          _config.contains("frameBudgetMs") &&
+                  _config["frameBudgetMs"].is_number()
+              ? _config["frameBudgetMs"].get<double>()
+              : 20.0,
+          priorityLines));
     }
   }
 
-  return unique_ptr<AbstractTracker>(new CvTracker(
-      []() { return cv::TrackerCSRT::create(); }, frameWidth, frameHeight));
+  return unique_ptr<AbstractTracker>(
+      new CvTracker([]() { return cv::TrackerCSRT::create(); }, frameWidth,
+                    frameHeight, reinitIouThreshold, cropTargetSize,
+                    cropSearchFactor, stationaryFrames, stationaryThreshold));
 }
 
 unique_ptr<AbstractVerifier> TrackerFactory::createVerifier(
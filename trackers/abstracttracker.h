@@ -1,60 +1,42 @@
 #ifndef TRACKERS_ABSTRACTTRACKER_H
 #define TRACKERS_ABSTRACTTRACKER_H
 
-#include <boost/optional.hpp>
-#include <list>
+#include <chrono>
 #include <utility>
+#include <vector>
 
+#include "framearena.h"
+#include "frameviews.h"
 #include "recognizers/abstractrecognizer.h"
 
+// Plain data, so that items are cheaply copied and kept in contiguous arrays
 struct TrackedItem {
+  enum Flags : unsigned char {
+    RECOGNIZED = 1  // Confirmed by recognizing algorithm on this frame
+  };
+
   int trackId;
-  boost::optional<int>
-      recType;  // Defined only if confirmed by recognizing algorithm
-  boost::optional<double>
-      recConfidence;  // Defined only if confirmed by recognizing algorithm
+  int recType;           // Defined only if RECOGNIZED
+  double recConfidence;  // Defined only if RECOGNIZED
   cv::Rect2d rect;
   int recFailsCount;  // How many times recognition algorithm does not confirm
                       // presence
+  unsigned char flags;
 
-  TrackedItem() : trackId(-1), recFailsCount(0) {}
+  TrackedItem()
+      : trackId(-1),
+        recType(-1),
+        recConfidence(0.0),
+        recFailsCount(0),
+        flags(0) {}
   TrackedItem(int _trackId, int _recType, double _recConfidence,
               const cv::Rect2d &_rect, int _recFailsCount)
       : trackId(_trackId),
         recType(_recType),
         recConfidence(_recConfidence),
         rect(_rect),
-        recFailsCount(_recFailsCount) {}
-  TrackedItem(int _trackId, int _recType, double _recConfidence,
-              cv::Rect2d &&_rect, int _recFailsCount)
-      : trackId(_trackId),
-        recType(_recType),
-        recConfidence(_recConfidence),
-        rect(std::move(_rect)),
-        recFailsCount(_recFailsCount) {}
-
-  // TrackedItem -> TrackedItem
-
-  TrackedItem(const TrackedItem &_other) = default;
-
-  TrackedItem &operator=(const TrackedItem &_other) = default;
-
-  TrackedItem(TrackedItem &&_other) noexcept
-      : trackId(std::exchange(_other.trackId, -1)),
-        recType(std::move(_other.recType)),
-        recConfidence(std::move(_other.recConfidence)),
-        rect(std::move(_other.rect)),
-        recFailsCount(std::exchange(_other.recFailsCount, 0)) {}
-
-  TrackedItem &operator=(TrackedItem &&_other) noexcept {
-    trackId = std::exchange(_other.trackId, -1);
-    recType = std::move(_other.recType);
-    recConfidence = std::move(_other.recConfidence);
-    rect = std::move(_other.rect);
-    recFailsCount = std::exchange(_other.recFailsCount, 0);
-
-    return *this;
-  }
+        recFailsCount(_recFailsCount),
+        flags(RECOGNIZED) {}
 
   // RecognizedItem -> TrackedItem
 
@@ -63,33 +45,32 @@ struct TrackedItem {
         recType(_recItem.type),
         recConfidence(_recItem.confidence),
         rect(_recItem.rect),
-        recFailsCount(0) {}
+        recFailsCount(0),
+        flags(RECOGNIZED) {}
 
   TrackedItem &operator=(const RecognizedItem &_recItem) {
     trackId = -1;
     recType = _recItem.type;
-    recConfidence = std::move(_recItem.confidence);
-    rect = std::move(_recItem.rect);
+    recConfidence = _recItem.confidence;
+    rect = _recItem.rect;
     recFailsCount = 0;
+    flags = RECOGNIZED;
 
     return *this;
   }
 
-  TrackedItem(RecognizedItem &&_recItem)
-      : trackId(-1),
-        recType(std::move(_recItem.type)),
-        recConfidence(std::move(_recItem.confidence)),
-        rect(std::move(_recItem.rect)),
-        recFailsCount(0) {}
+  bool isRecognized() const { return flags & RECOGNIZED; }
 
-  TrackedItem &operator=(RecognizedItem &&_recItem) {
-    trackId = -1;
-    recType = std::move(_recItem.type);
-    recConfidence = std::move(_recItem.confidence);
-    rect = std::move(_recItem.rect);
-    recFailsCount = 0;
+  void setRecognized(int _recType, double _recConfidence) {
+    recType = _recType;
+    recConfidence = _recConfidence;
+    flags |= RECOGNIZED;
+  }
 
-    return *this;
+  void resetRecognized() {
+    recType = -1;
+    recConfidence = 0.0;
+    flags &= ~RECOGNIZED;
   }
 };
 
@@ -98,10 +79,14 @@ class AbstractTracker {
   explicit AbstractTracker() {}
   virtual ~AbstractTracker() {}
 
-  virtual std::list<TrackedItem> track(const cv::Mat &_frame) = 0;
+  // Returned items are valid until next call of track() or reset()
+  virtual const FrameVector<TrackedItem> &track(
+      FrameViews &_frame,
+      const std::chrono::time_point<std::chrono::system_clock>
+          &_timestamp) = 0;
 
-  virtual void reset(const cv::Mat &_frame,
-                     const std::list<TrackedItem> &_items) = 0;
+  virtual void reset(FrameViews &_frame,
+                     const FrameVector<TrackedItem> &_items) = 0;
 };
 
 #endif  // TRACKERS_ABSTRACTTRACKER_H
@@ -0,0 +1,189 @@
+#include "trackers/budgettracker.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <cmath>
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+double distanceToSegment(const Point2d &_p, const Point2d &_a,
+                         const Point2d &_b) {
+  double dx = _b.x - _a.x, dy = _b.y - _a.y;
+  double len2 = dx * dx + dy * dy;
+  double t = len2 > 0.0 ? ((_p.x - _a.x) * dx + (_p.y - _a.y) * dy) / len2
+                        : 0.0;
+  t = std::min(std::max(t, 0.0), 1.0);
+
+  return std::hypot(_p.x - _a.x - t * dx, _p.y - _a.y - t * dy);
+}
+
+}  // namespace
+
+BudgetTracker::BudgetTracker(
+    vector<CvTrackerCreateFunction> _createFuncs, int _frameSizeX,
+    int _frameSizeY, double _reinitIouThreshold, int _cropTargetSize,
+    double _cropSearchFactor, int _stationaryFrames,
+    double _stationaryThreshold, double _frameBudgetMs,
+    const vector<pair<Point2d, Point2d>> &_priorityLines)
+    : CvTracker(move(_createFuncs), _frameSizeX, _frameSizeY,
+                _reinitIouThreshold, _cropTargetSize, _cropSearchFactor,
+                _stationaryFrames, _stationaryThreshold),
+      mFrameBudgetMs(_frameBudgetMs),
+      mPriorityLines(_priorityLines) {
+  // Initial guess, every next algorithm is about 4 times cheaper. Real costs
+  // are learned while working.
+  for (size_t i = 0; i < mCreateFunctions.size(); ++i)
+    mAlgorithmCostMs.push_back(5.0 / pow(4.0, i));
+  mAlgorithmCostMs.push_back(0.0);
+}
+
+const FrameVector<TrackedItem> &BudgetTracker::track(
+    FrameViews &_frame,
+    const chrono::time_point<chrono::system_clock> &_timestamp) {
+  CvTracker::track(_frame, _timestamp);
+
+  for (const auto &slot : mSlots)
+    if (slot.algorithm < mCreateFunctions.size() && slot.costMs > 0.0)
+      mAlgorithmCostMs[slot.algorithm] =
+          0.95 * mAlgorithmCostMs[slot.algorithm] + 0.05 * slot.costMs;
+
+  rebalance(mTrackedItems);
+
+  // Cheaper algorithms are applied at once to fit the budget on next frame,
+  // more precise ones wait for reset, because it reinitialises trackers anyway
+  int downgraded = 0;
+
+  size_t i = 0;
+  while (i < mSlots.size()) {
+    size_t algorithm = chooseAlgorithm(mTrackedItems[i]);
+
+    if (algorithm > mSlots[i].algorithm) {
+      // Cost is learned anew, re-init is not counted as update
+      mSlots[i].algorithm = algorithm;
+      mSlots[i].costMs = 0.0;
+      ++downgraded;
+
+      if (!initSlot(_frame, mTrackedItems[i].rect, mSlots[i])) {
+        eraseSlot(i);
+
+        BOOST_LOG_TRIVIAL(trace) << "Tracker item has been lost and removed";
+        continue;
+      }
+    }
+
+    ++i;
+  }
+
+  if (downgraded > 0)
+    BOOST_LOG_TRIVIAL(trace) << "BudgetTracker: " << downgraded
+                             << " trackers downgraded to fit budget";
+
+  return mTrackedItems;
+}
+
+void BudgetTracker::reset(FrameViews &_frame,
+                          const FrameVector<TrackedItem> &_items) {
+  unordered_map<int, chrono::time_point<chrono::system_clock>> lastVerified;
+
+  for (const auto &item : _items)
+    if (item.isRecognized())
+      lastVerified[item.trackId] = mTimestamp;
+    else if (mLastVerified.count(item.trackId))
+      lastVerified[item.trackId] = mLastVerified[item.trackId];
+
+  mLastVerified = move(lastVerified);
+
+  rebalance(_items);
+
+  CvTracker::reset(_frame, _items);
+}
+
+size_t BudgetTracker::chooseAlgorithm(const TrackedItem &_item) {
+  auto it = lower_bound(mAssignment.begin(), mAssignment.end(),
+                        make_pair(_item.trackId, size_t(0)));
+
+  return it != mAssignment.end() && it->first == _item.trackId ? it->second
+                                                                : 0;
+}
+
+double BudgetTracker::importance(const TrackedItem &_item) const {
+  Point2d center(_item.rect.x + _item.rect.width / 2,
+                 _item.rect.y + _item.rect.height / 2);
+  double diag = std::hypot(_item.rect.width, _item.rect.height);
+
+  double nearLine = 0.0;
+  for (const auto &l : mPriorityLines)
+    nearLine = std::max(nearLine,
+                        1.0 - distanceToSegment(center, l.first, l.second) /
+                                  (2.0 * diag + 1.0));
+
+  double verified = 0.0;
+  auto it = mLastVerified.find(_item.trackId);
+  if (it != mLastVerified.end())
+    verified =
+        exp(-chrono::duration<double>(mTimestamp - it->second).count());
+
+  double size = std::min(std::sqrt(_item.rect.area()) / 100.0, 1.0);
+
+  return 2.0 * std::max(nearLine, 0.0) + verified + size;
+}
+
+double BudgetTracker::estimateCostMs(const TrackerSlot *_slot,
+                                     size_t _algorithm) const {
+  // Frozen object costs nothing until it moves
+  if (_slot && _slot->frozen) return 0.0;
+
+  // Own measured cost, scaled by relative cost of algorithms
+  if (_slot && _slot->algorithm < mCreateFunctions.size() &&
+      _slot->costMs > 0.0 && mAlgorithmCostMs[_slot->algorithm] > 0.0)
+    return _slot->costMs * mAlgorithmCostMs[_algorithm] /
+           mAlgorithmCostMs[_slot->algorithm];
+
+  return mAlgorithmCostMs[_algorithm];
+}
+
+void BudgetTracker::rebalance(const FrameVector<TrackedItem> &_items) {
+  mSlotIndex.clear();
+  for (size_t i = 0; i < mTrackedItems.size(); ++i)
+    mSlotIndex.push_back(make_pair(mTrackedItems[i].trackId, i));
+  sort(mSlotIndex.begin(), mSlotIndex.end());
+
+  mOrder.clear();
+  for (size_t i = 0; i < _items.size(); ++i)
+    mOrder.push_back(make_pair(importance(_items[i]), i));
+
+  sort(mOrder.begin(), mOrder.end(),
+       [](const auto &_a, const auto &_b) { return _a.first > _b.first; });
+
+  mAssignment.clear();
+
+  double left = mFrameBudgetMs;
+
+  for (const auto &o : mOrder) {
+    int trackId = _items[o.second].trackId;
+    auto it = lower_bound(mSlotIndex.begin(), mSlotIndex.end(),
+                          make_pair(trackId, size_t(0)));
+    const TrackerSlot *slot =
+        it != mSlotIndex.end() && it->first == trackId ? &mSlots[it->second]
+                                                       : nullptr;
+
+    // The most precise algorithm, that fits the rest of budget
+    size_t algorithm = 0;
+    while (algorithm < mCreateFunctions.size() &&
+           estimateCostMs(slot, algorithm) > left)
+      ++algorithm;
+
+    left -= estimateCostMs(slot, algorithm);
+    mAssignment.push_back(make_pair(trackId, algorithm));
+  }
+
+  sort(mAssignment.begin(), mAssignment.end());
+
+  BOOST_LOG_TRIVIAL(trace) << "BudgetTracker: " << _items.size()
+                           << " objects scheduled, "
+                           << mFrameBudgetMs - left << " of "
+                           << mFrameBudgetMs << " ms expected";
+}
@@ -0,0 +1,56 @@
+#ifndef TRACKERS_BUDGETTRACKER_H
+#define TRACKERS_BUDGETTRACKER_H
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "trackers/cvtracker.h"
+
+// Shares per frame time budget among objects: the most important ones get
+// the most precise tracker, the rest get cheaper ones or only motion
+// extrapolation
+class BudgetTracker : public CvTracker {
+ public:
+  // _createFuncs are ordered from the most precise (and expensive) tracker to
+  // the cheapest one. _priorityLines are counting lines, objects near them are
+  // more important.
+  explicit BudgetTracker(
+      std::vector<CvTrackerCreateFunction> _createFuncs, int _frameSizeX,
+      int _frameSizeY, double _reinitIouThreshold, int _cropTargetSize,
+      double _cropSearchFactor, int _stationaryFrames,
+      double _stationaryThreshold, double _frameBudgetMs,
+      const std::vector<std::pair<cv::Point2d, cv::Point2d>> &_priorityLines);
+
+  virtual const FrameVector<TrackedItem> &track(
+      FrameViews &_frame,
+      const std::chrono::time_point<std::chrono::system_clock> &_timestamp)
+      override;
+
+  virtual void reset(FrameViews &_frame,
+                     const FrameVector<TrackedItem> &_items) override;
+
+ protected:
+  double mFrameBudgetMs;
+  std::vector<std::pair<cv::Point2d, cv::Point2d>> mPriorityLines;
+  // Average update time of one object per algorithm, the last one is motion
+  // extrapolation
+  std::vector<double> mAlgorithmCostMs;
+  // Track id -> algorithm, sorted by track id
+  std::vector<std::pair<int, size_t>> mAssignment;
+  std::unordered_map<int, std::chrono::time_point<std::chrono::system_clock>>
+      mLastVerified;
+
+  virtual size_t chooseAlgorithm(const TrackedItem &_item) override;
+
+  double importance(const TrackedItem &_item) const;
+  double estimateCostMs(const TrackerSlot *_slot, size_t _algorithm) const;
+  void rebalance(const FrameVector<TrackedItem> &_items);
+
+ private:
+  // Workspace of rebalance(), kept between calls
+  std::vector<std::pair<int, size_t>> mSlotIndex;  // Track id -> mSlots index
+  std::vector<std::pair<double, size_t>> mOrder;   // Importance -> item index
+};
+
+#endif  // TRACKERS_BUDGETTRACKER_H
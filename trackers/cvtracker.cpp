@@ -1,62 +1,57 @@
 #include "trackers/cvtracker.h"
 
+#include <algorithm>
 #include <boost/log/trivial.hpp>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+
+#include "utilities.h"
 
 using namespace cv;
 using namespace std;
 
 CvTracker::CvTracker(CvTrackerCreateFunction _createFunc, int _frameSizeX,
-                     int _frameSizeY)
+                     int _frameSizeY, double _reinitIouThreshold,
+                     int _cropTargetSize, double _cropSearchFactor,
+                     int _stationaryFrames, double _stationaryThreshold)
+    : CvTracker(vector<CvTrackerCreateFunction>{_createFunc}, _frameSizeX,
+                _frameSizeY, _reinitIouThreshold, _cropTargetSize,
+                _cropSearchFactor, _stationaryFrames, _stationaryThreshold) {}
+
+CvTracker::CvTracker(vector<CvTrackerCreateFunction> _createFuncs,
+                     int _frameSizeX, int _frameSizeY,
+                     double _reinitIouThreshold, int _cropTargetSize,
+                     double _cropSearchFactor, int _stationaryFrames,
+                     double _stationaryThreshold)
     : AbstractTracker(),
-      mCreateFunction(_createFunc),
+      mCreateFunctions(move(_createFuncs)),
       mFrameSizeX(_frameSizeX),
-      mFrameSizeY(_frameSizeY) {}
-
-list<TrackedItem> CvTracker::track(const Mat &_frame) {
-  Mat bufFrame;
-  cvtColor(_frame, bufFrame, cv::COLOR_BGR2GRAY);
-  resize(bufFrame, bufFrame, cv::Size(mFrameSizeX, mFrameSizeY));
-
-  double scaleX =
-      static_cast<double>(_frame.cols) / static_cast<double>(mFrameSizeX);
-  double scaleY =
-      static_cast<double>(_frame.rows) / static_cast<double>(mFrameSizeY);
+      mFrameSizeY(_frameSizeY),
+      mReinitIouThreshold(_reinitIouThreshold),
+      mCropTargetSize(_cropTargetSize),
+      mCropSearchFactor(std::max(_cropSearchFactor, 1.0)),
+      mStationaryFrames(_stationaryFrames),
+      mStationaryThreshold(_stationaryThreshold),
+      mAvgInitMs(0.0),
+      mTimestamp(chrono::system_clock::now()) {}
 
-  // For mTrackedItems and mCvTrackers have same objects
-  // (This is antipattern), we must ensure that are exactly same
-  assert(mTrackedItems.size() == mCvTrackers.size());
+const FrameVector<TrackedItem> &CvTracker::track(
+    FrameViews &_frame,
+    const chrono::time_point<chrono::system_clock> &_timestamp) {
+  mPrevBufFrame = mBufFrame;
+  mBufFrame.release();
+  mTimestamp = _timestamp;
 
-  auto it_t = mCvTrackers.begin();
-  auto it_i = mTrackedItems.begin();
+  assert(mTrackedItems.size() == mSlots.size());
 
-  while (it_t != mCvTrackers.end() && it_i != mTrackedItems.end()) {
-    Rect2d bbox;
-    // If rect is small, it failed
-    if (it_i->rect.width > 10 && it_i->rect.height > 10 &&
-        (*it_t)->update(bufFrame, bbox)) {
-      it_i->rect = Rect2d(bbox.x * scaleX, bbox.y * scaleY, bbox.width * scaleX,
-                          bbox.height * scaleY);
-      it_i->recType = boost::none;
-      it_i->recConfidence = boost::none;
-
-      // boundary checking
-      it_i->rect = it_i->rect & Rect2d(0, 0, _frame.cols, _frame.rows);
-
-      if (!it_i->rect.empty()) {
-        // All is ok
-        ++it_t;
-        ++it_i;
-      } else {
-        // Invalid rect. Delete it
-        mCvTrackers.erase(it_t++);
-        mTrackedItems.erase(it_i++);
-
-        BOOST_LOG_TRIVIAL(trace) << "Tracker item has been lost and removed";
-      }
+  size_t i = 0;
+  while (i < mSlots.size()) {
+    if (updateSlot(_frame, mSlots[i], mTrackedItems[i])) {
+      // All is ok
+      ++i;
     } else {
-      mCvTrackers.erase(it_t++);
-      mTrackedItems.erase(it_i++);
+      eraseSlot(i);
 
       BOOST_LOG_TRIVIAL(trace) << "Tracker item has been lost and removed";
     }
@@ -65,32 +60,275 @@ list<TrackedItem> CvTracker::track(const Mat &_frame) {
   return mTrackedItems;
 }
 
-void CvTracker::reset(const Mat &_frame, const list<TrackedItem> &_items) {
-  mCvTrackers.clear();
-  mTrackedItems.clear();
+void CvTracker::reset(FrameViews &_frame,
+                      const FrameVector<TrackedItem> &_items) {
+  // Slots, which are already updated on this frame, sorted by track id
+  swap(mPrevSlots, mSlots);
+  swap(mPrevItems, mTrackedItems);
 
-  Mat bufFrame;
-  cvtColor(_frame, bufFrame, cv::COLOR_BGR2GRAY);
-  resize(bufFrame, bufFrame, cv::Size(mFrameSizeX, mFrameSizeY));
+  mPrevIndex.clear();
+  for (size_t i = 0; i < mPrevItems.size(); ++i)
+    mPrevIndex.push_back(make_pair(mPrevItems[i].trackId, i));
+  sort(mPrevIndex.begin(), mPrevIndex.end());
 
-  double scaleX =
-      static_cast<double>(_frame.cols) / static_cast<double>(mFrameSizeX);
-  double scaleY =
-      static_cast<double>(_frame.rows) / static_cast<double>(mFrameSizeY);
+  mSlots.clear();
+  mTrackedItems.clear();
+
+  int kept = 0, inited = 0;
+  double initMs = 0.0;
 
   for (const auto &item : _items) {
-    Rect2d bufRect(item.rect.x / scaleX, item.rect.y / scaleY,
-                   item.rect.width / scaleX, item.rect.height / scaleY);
+    size_t algorithm = chooseAlgorithm(item);
+
+    auto it_prev = lower_bound(mPrevIndex.begin(), mPrevIndex.end(),
+                               make_pair(item.trackId, size_t(0)));
+    TrackerSlot *prev =
+        it_prev != mPrevIndex.end() && it_prev->first == item.trackId
+            ? &mPrevSlots[it_prev->second]
+            : nullptr;
+
+    if (prev && prev->algorithm == algorithm &&
+        getIOU(mPrevItems[it_prev->second].rect, item.rect) >=
+            mReinitIouThreshold) {
+      // Box barely changed, tracker keeps its state
+      prev->motion.update(item.rect, mTimestamp);
+      mSlots.push_back(move(*prev));
+      mTrackedItems.push_back(item);
+      ++kept;
+      continue;
+    }
 
-    auto t = mCreateFunction();
+    auto t0 = chrono::steady_clock::now();
 
-    // If rect is small, it failed
-    if (bufRect.width > 2.0 && bufRect.height > 2.0 && t &&
-        t->init(bufFrame, bufRect)) {
-      mCvTrackers.push_back(t);
+    // Keep motion history of known items, and cost if algorithm is the same
+    TrackerSlot slot = prev ? move(*prev) : TrackerSlot();
+    if (slot.algorithm != algorithm) slot.costMs = 0.0;
+    slot.algorithm = algorithm;
+
+    if (initSlot(_frame, item.rect, slot)) {
+      slot.motion.update(item.rect, mTimestamp);
+      mSlots.push_back(move(slot));
       mTrackedItems.push_back(item);
+
+      initMs += chrono::duration<double, milli>(chrono::steady_clock::now() -
+                                                t0)
+                    .count();
+      ++inited;
     } else {
       BOOST_LOG_TRIVIAL(fatal) << "Can not add item";
     }
   }
+
+  // Release trackers of removed items, memory is kept
+  mPrevSlots.clear();
+  mPrevItems.clear();
+
+  if (inited > 0)
+    mAvgInitMs = mAvgInitMs > 0.0
+                     ? 0.9 * mAvgInitMs + 0.1 * (initMs / inited)
+                     : initMs / inited;
+
+  BOOST_LOG_TRIVIAL(trace) << "CvTracker: " << kept << " trackers kept, "
+                           << inited << " reinitialised, ~"
+                           << kept * mAvgInitMs << " ms saved";
+}
+
+size_t CvTracker::chooseAlgorithm(const TrackedItem &) { return 0; }
+
+void CvTracker::eraseSlot(size_t _index) {
+  mSlots.erase(mSlots.begin() + _index);
+  mTrackedItems.erase(mTrackedItems.begin() + _index);
+}
+
+bool CvTracker::initSlot(FrameViews &_frame, const Rect2d &_rect,
+                         TrackerSlot &_slot) {
+  if (mCropTargetSize > 0) {
+    // Object size is about mCropTargetSize pixels, but upscale is limited
+    double scale =
+        std::max(std::max(_rect.width, _rect.height) / mCropTargetSize, 0.25);
+
+    double w = _rect.width * mCropSearchFactor;
+    double h = _rect.height * mCropSearchFactor;
+
+    _slot.window = Rect(cvRound(_rect.x + _rect.width / 2 - w / 2),
+                        cvRound(_rect.y + _rect.height / 2 - h / 2),
+                        cvRound(w), cvRound(h)) &
+                   Rect(0, 0, _frame.cols(), _frame.rows());
+    _slot.scaleX = _slot.scaleY = scale;
+  } else {
+    _slot.window = Rect(0, 0, _frame.cols(), _frame.rows());
+    _slot.scaleX =
+        static_cast<double>(_frame.cols()) / static_cast<double>(mFrameSizeX);
+    _slot.scaleY =
+        static_cast<double>(_frame.rows()) / static_cast<double>(mFrameSizeY);
+  }
+
+  _slot.anchor = _rect;
+  _slot.stillFrames = 0;
+  _slot.frozen = false;
+  _slot.stillRef.release();
+
+  if (_slot.algorithm >= mCreateFunctions.size()) {
+    // Motion extrapolation only
+    _slot.cvTracker = Ptr<Tracker>();
+    return !_rect.empty();
+  }
+
+  if (_slot.window.empty()) return false;
+
+  Rect2d bufRect((_rect.x - _slot.window.x) / _slot.scaleX,
+                 (_rect.y - _slot.window.y) / _slot.scaleY,
+                 _rect.width / _slot.scaleX, _rect.height / _slot.scaleY);
+
+  _slot.cvTracker = mCreateFunctions[_slot.algorithm]();
+
+  // If rect is small, it failed
+  return bufRect.width > 2.0 && bufRect.height > 2.0 && _slot.cvTracker &&
+         _slot.cvTracker->init(slotImage(_frame, _slot), bufRect);
+}
+
+bool CvTracker::updateSlot(FrameViews &_frame, TrackerSlot &_slot,
+                           TrackedItem &_item) {
+  if (isStationary(_frame, _slot, _item)) {
+    _item.resetRecognized();
+    _slot.motion.update(_item.rect, mTimestamp);
+
+    return true;
+  }
+
+  auto t0 = chrono::steady_clock::now();
+
+  if (_slot.cvTracker) {
+    Rect2d bbox;
+    // If rect is small, it failed (in crop mode object is always scaled up)
+    if (!((mCropTargetSize > 0 ||
+           (_item.rect.width > 10 && _item.rect.height > 10)) &&
+          _slot.cvTracker->update(slotImage(_frame, _slot), bbox)))
+      return false;
+
+    _item.rect = Rect2d(_slot.window.x + bbox.x * _slot.scaleX,
+                        _slot.window.y + bbox.y * _slot.scaleY,
+                        bbox.width * _slot.scaleX, bbox.height * _slot.scaleY);
+  } else {
+    _item.rect = _slot.motion.predict(mTimestamp);
+  }
+
+  _item.resetRecognized();
+
+  // boundary checking
+  _item.rect = _item.rect & Rect2d(0, 0, _frame.cols(), _frame.rows());
+
+  // Invalid rect
+  if (_item.rect.empty()) return false;
+
+  _slot.motion.update(_item.rect, mTimestamp);
+
+  double dt =
+      chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+  _slot.costMs = _slot.costMs > 0.0 ? 0.8 * _slot.costMs + 0.2 * dt : dt;
+
+  // Object is going out of its search window, so build new one around it
+  return !isAnchorLost(_slot, _item.rect) ||
+         initSlot(_frame, _item.rect, _slot);
+}
+
+Mat CvTracker::slotImage(FrameViews &_frame, const TrackerSlot &_slot) {
+  if (mCropTargetSize <= 0) return bufFrame(_frame);
+
+  // Size must be the same for every call with the same slot
+  return _frame.gray(
+      _slot.window,
+      cv::Size(std::max(cvRound(_slot.window.width / _slot.scaleX), 1),
+               std::max(cvRound(_slot.window.height / _slot.scaleY), 1)));
+}
+
+bool CvTracker::isAnchorLost(const TrackerSlot &_slot,
+                             const Rect2d &_rect) const {
+  if (mCropTargetSize <= 0 || !_slot.cvTracker) return false;
+
+  // Object may move up to half of the free space around it
+  double maxShift = (mCropSearchFactor - 1.0) / 4.0;
+
+  return std::abs(_rect.x + _rect.width / 2 - _slot.anchor.x -
+                  _slot.anchor.width / 2) > maxShift * _slot.anchor.width ||
+         std::abs(_rect.y + _rect.height / 2 - _slot.anchor.y -
+                  _slot.anchor.height / 2) > maxShift * _slot.anchor.height ||
+         _rect.area() > 2.0 * _slot.anchor.area() ||
+         _rect.area() < 0.5 * _slot.anchor.area();
+}
+
+const Mat &CvTracker::bufFrame(FrameViews &_frame) {
+  if (mBufFrame.empty())
+    mBufFrame = _frame.gray(cv::Size(mFrameSizeX, mFrameSizeY));
+
+  return mBufFrame;
+}
+
+bool CvTracker::isStationary(FrameViews &_frame, TrackerSlot &_slot,
+                             const TrackedItem &_item) {
+  if (mStationaryFrames <= 0) return false;
+
+  const Mat &cur = bufFrame(_frame);
+
+  double scaleX =
+      static_cast<double>(_frame.cols()) / static_cast<double>(mFrameSizeX);
+  double scaleY =
+      static_cast<double>(_frame.rows()) / static_cast<double>(mFrameSizeY);
+
+  // Object area with some neighbourhood on scaled frame
+  Rect area = Rect(cvFloor((_item.rect.x - _item.rect.width / 4) / scaleX),
+                   cvFloor((_item.rect.y - _item.rect.height / 4) / scaleY),
+                   cvCeil(1.5 * _item.rect.width / scaleX),
+                   cvCeil(1.5 * _item.rect.height / scaleY)) &
+              Rect(0, 0, cur.cols, cur.rows);
+
+  // Frozen object is compared with the same area at the moment of freezing
+  if (_slot.frozen) area = _slot.stillArea;
+
+  const Mat &ref = _slot.frozen ? _slot.stillRef : mPrevBufFrame;
+
+  if (area.empty() || ref.empty() ||
+      (area & Rect(0, 0, cur.cols, cur.rows)) != area ||
+      (!_slot.frozen && ref.size() != cur.size())) {
+    _slot.stillFrames = 0;
+    _slot.frozen = false;
+    _slot.stillRef.release();
+    return false;
+  }
+
+  // Mean difference in 4x4 blocks
+  Mat diff;
+  absdiff(cur(area), _slot.frozen ? ref : ref(area), diff);
+  resize(diff, diff,
+         cv::Size((diff.cols + 3) / 4, (diff.rows + 3) / 4), 0, 0,
+         cv::INTER_AREA);
+
+  double maxDiff = 0.0;
+  minMaxLoc(diff, nullptr, &maxDiff);
+
+  bool still = maxDiff <= mStationaryThreshold;
+
+  if (_slot.frozen) {
+    if (still) return true;
+
+    // Motion resumed
+    _slot.stillFrames = 0;
+    _slot.frozen = false;
+    _slot.stillRef.release();
+
+    BOOST_LOG_TRIVIAL(trace) << "Tracker item has been unfrozen";
+    return false;
+  }
+
+  _slot.stillFrames = still ? _slot.stillFrames + 1 : 0;
+
+  if (_slot.stillFrames >= mStationaryFrames) {
+    _slot.frozen = true;
+    _slot.stillArea = area;
+    _slot.stillRef = cur(area).clone();
+
+    BOOST_LOG_TRIVIAL(trace) << "Tracker item has been frozen";
+  }
+
+  return _slot.frozen;
 }
@@ -3,26 +3,102 @@
 
 #include <functional>
 #include <opencv2/tracking.hpp>
+#include <utility>
+#include <vector>
 
 #include "trackers/abstracttracker.h"
+#include "trackers/motionmodel.h"
 
 class CvTracker : public AbstractTracker {
  public:
   using CvTrackerCreateFunction = std::function<cv::Ptr<cv::Tracker>()>;
 
+  // If _cropTargetSize > 0, every object is tracked in its own search window
+  // (_cropSearchFactor times bigger than object) scaled so that object is
+  // about _cropTargetSize pixels. Otherwise whole frame is scaled to
+  // _frameSizeX x _frameSizeY.
+  // If _stationaryFrames > 0, object without changes in its area (no block
+  // of scaled gray frame differs more than _stationaryThreshold) during
+  // _stationaryFrames frames is frozen and not updated until motion resumes.
   explicit CvTracker(CvTrackerCreateFunction _createFunc, int _frameSizeX,
-                     int _frameSizeY);
+                     int _frameSizeY, double _reinitIouThreshold,
+                     int _cropTargetSize, double _cropSearchFactor,
+                     int _stationaryFrames, double _stationaryThreshold);
 
-  virtual std::list<TrackedItem> track(const cv::Mat &_frame) override;
+  virtual const FrameVector<TrackedItem> &track(
+      FrameViews &_frame,
+      const std::chrono::time_point<std::chrono::system_clock> &_timestamp)
+      override;
 
-  virtual void reset(const cv::Mat &_frame,
-                     const std::list<TrackedItem> &_items) override;
+  virtual void reset(FrameViews &_frame,
+                     const FrameVector<TrackedItem> &_items) override;
 
  protected:
-  CvTrackerCreateFunction mCreateFunction;
+  // cv::Tracker and the part of frame it works with
+  struct TrackerSlot {
+    cv::Ptr<cv::Tracker> cvTracker;  // Empty for motion extrapolation
+    cv::Rect window;                 // Frame region fed to cvTracker
+    double scaleX, scaleY;           // Frame pixels per cvTracker pixel
+    cv::Rect2d anchor;               // Item rect, window was built for
+    size_t algorithm;  // Index in mCreateFunctions, out of range for motion
+                       // extrapolation
+    double costMs;     // Moving average of update time by algorithm, 0 if
+                       // not measured yet
+    MotionModel motion;
+    int stillFrames;   // How many frames object area does not change
+    bool frozen;       // Object is stationary, updates are skipped
+    cv::Rect stillArea;  // Area of scaled frame, stillRef is taken from
+    cv::Mat stillRef;    // Object area at the moment of freezing
+
+    TrackerSlot()
+        : scaleX(1.0),
+          scaleY(1.0),
+          algorithm(0),
+          costMs(0.0),
+          stillFrames(0),
+          frozen(false) {}
+  };
+
+  std::vector<CvTrackerCreateFunction> mCreateFunctions;
   int mFrameSizeX, mFrameSizeY;
-  std::list<cv::Ptr<cv::Tracker>> mCvTrackers;
-  std::list<TrackedItem> mTrackedItems;
+  // Tracker is kept on reset, if IOU between its box and verified box is not
+  // less than this value
+  double mReinitIouThreshold;
+  int mCropTargetSize;
+  double mCropSearchFactor;
+  int mStationaryFrames;
+  double mStationaryThreshold;
+  double mAvgInitMs;  // Moving average of one tracker init() time
+  // Same objects in the same order
+  std::vector<TrackerSlot> mSlots;
+  FrameVector<TrackedItem> mTrackedItems;
+  // Previous state while reset, kept to reuse memory
+  std::vector<TrackerSlot> mPrevSlots;
+  FrameVector<TrackedItem> mPrevItems;
+  std::vector<std::pair<int, size_t>> mPrevIndex;  // Track id -> index
+  cv::Mat mBufFrame;  // Whole gray scaled frame, prepared once per frame
+  cv::Mat mPrevBufFrame;
+  std::chrono::time_point<std::chrono::system_clock> mTimestamp;
+
+  explicit CvTracker(std::vector<CvTrackerCreateFunction> _createFuncs,
+                     int _frameSizeX, int _frameSizeY,
+                     double _reinitIouThreshold, int _cropTargetSize,
+                     double _cropSearchFactor, int _stationaryFrames,
+                     double _stationaryThreshold);
+
+  // Which algorithm to use for item, that must be (re)initialised
+  virtual size_t chooseAlgorithm(const TrackedItem &_item);
+
+  bool initSlot(FrameViews &_frame, const cv::Rect2d &_rect,
+                TrackerSlot &_slot);
+  bool updateSlot(FrameViews &_frame, TrackerSlot &_slot,
+                  TrackedItem &_item);
+  cv::Mat slotImage(FrameViews &_frame, const TrackerSlot &_slot);
+  const cv::Mat &bufFrame(FrameViews &_frame);
+  bool isStationary(FrameViews &_frame, TrackerSlot &_slot,
+                    const TrackedItem &_item);
+  bool isAnchorLost(const TrackerSlot &_slot, const cv::Rect2d &_rect) const;
+  void eraseSlot(size_t _index);
 };
 
 #endif  // TRACKERS_CVTRACKER_H
@@ -0,0 +1,54 @@
+#ifndef TRACKERS_MOTIONMODEL_H
+#define TRACKERS_MOTIONMODEL_H
+
+#include <chrono>
+#include <opencv2/core/core.hpp>
+
+// Constant velocity model of a box, used to extrapolate its position
+class MotionModel {
+ public:
+  MotionModel() : mVx(0.0), mVy(0.0), mValid(false) {}
+
+  void update(const cv::Rect2d &_rect,
+              const std::chrono::time_point<std::chrono::system_clock> &_ts) {
+    if (mValid) {
+      double dt = std::chrono::duration<double>(_ts - mTs).count();
+
+      if (dt > 0.0) {
+        // Smoothed to suppress tracker jitter
+        mVx = 0.5 * mVx + 0.5 * (_rect.x + _rect.width / 2 - mRect.x -
+                                 mRect.width / 2) /
+                              dt;
+        mVy = 0.5 * mVy + 0.5 * (_rect.y + _rect.height / 2 - mRect.y -
+                                 mRect.height / 2) /
+                              dt;
+        mTs = _ts;
+      }
+    } else {
+      mTs = _ts;
+    }
+
+    mRect = _rect;
+    mValid = true;
+  }
+
+  cv::Rect2d predict(
+      const std::chrono::time_point<std::chrono::system_clock> &_ts) const {
+    if (!mValid) return cv::Rect2d();
+
+    double dt = std::chrono::duration<double>(_ts - mTs).count();
+
+    return cv::Rect2d(mRect.x + mVx * dt, mRect.y + mVy * dt, mRect.width,
+                      mRect.height);
+  }
+
+  bool valid() const { return mValid; }
+
+ private:
+  cv::Rect2d mRect;
+  std::chrono::time_point<std::chrono::system_clock> mTs;
+  double mVx, mVy;  // Pixels per second
+  bool mValid;
+};
+
+#endif  // TRACKERS_MOTIONMODEL_H
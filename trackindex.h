@@ -0,0 +1,56 @@
+#ifndef TRACKINDEX_H
+#define TRACKINDEX_H
+
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+// Track id -> index map with open addressing and linear probing. It is
+// rebuilt for every frame, so there is no erase; memory is kept between
+// frames.
+class TrackIndex {
+ public:
+  TrackIndex() : mMask(0) {}
+
+  // Removes all entries, table is ready for _count insertions
+  void reset(size_t _count) {
+    size_t capacity = 16;
+    while (capacity < 2 * _count) capacity *= 2;
+
+    mKeys.assign(capacity, emptyKey);
+    mValues.resize(capacity);
+    mMask = capacity - 1;
+  }
+
+  void insert(int _trackId, int _index) {
+    size_t i = slot(_trackId);
+    while (mKeys[i] != emptyKey && mKeys[i] != _trackId) i = (i + 1) & mMask;
+
+    mKeys[i] = _trackId;
+    mValues[i] = _index;
+  }
+
+  // -1 if there is no such track id
+  int find(int _trackId) const {
+    if (mKeys.empty()) return -1;
+
+    for (size_t i = slot(_trackId);; i = (i + 1) & mMask) {
+      if (mKeys[i] == _trackId) return mValues[i];
+      if (mKeys[i] == emptyKey) return -1;
+    }
+  }
+
+ private:
+  enum : int { emptyKey = INT_MIN };
+
+  std::vector<int> mKeys, mValues;
+  size_t mMask;
+
+  size_t slot(int _trackId) const {
+    // Multiplication by odd number permutes low bits, so sequential ids do
+    // not collide
+    return (static_cast<uint32_t>(_trackId) * 2654435769u) & mMask;
+  }
+};
+
+#endif  // TRACKINDEX_H
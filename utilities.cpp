@@ -1,6 +1,7 @@
 #include "utilities.h"
 
 #include <iomanip>
+#include <limits>
 #include <sstream>
 
 using namespace std::chrono;
@@ -20,3 +21,10 @@ std::string timeToStrWithMs(const time_point<system_clock> &_timestamp) {
 
   return oss.str();
 }
+
+double getIOU(const cv::Rect2d &_r1, const cv::Rect2d &_r2) {
+  double in = (_r1 & _r2).area();
+  double un = _r1.area() + _r2.area() - in;
+
+  return un < std::numeric_limits<double>::epsilon() ? 0.0 : in / un;
+}
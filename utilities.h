@@ -2,9 +2,13 @@
 #define UTILITIES_H
 
 #include <chrono>
+#include <opencv2/core/core.hpp>
 #include <string>
 
 std::string timeToStrWithMs(
     const std::chrono::time_point<std::chrono::system_clock> &_timestamp);
 
+// Computes IOU between two bounding boxes
+double getIOU(const cv::Rect2d &_r1, const cv::Rect2d &_r2);
+
 #endif  // UTILITIES_H
@@ -0,0 +1,405 @@
+#include "v4l2device.h"
+
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <opencv2/imgproc.hpp>
+#include <utility>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+// BGR24 frames are copied, when fewer buffers are queued in driver, so that it
+// always has where to capture next frames
+const int reservedBuffers = 2;
+
+// Formats in order of preference, if requested one is not supported. BGR24
+// needs no conversion, MJPEG is decoded by stages at reduced scale.
+const uint32_t knownFormats[] = {V4L2_PIX_FMT_BGR24, V4L2_PIX_FMT_MJPEG,
+                                 V4L2_PIX_FMT_JPEG, V4L2_PIX_FMT_YUYV,
+                                 V4L2_PIX_FMT_GREY};
+
+int xioctl(int _fd, unsigned long _request, void *_arg) {
+  int r;
+
+  do {
+    r = ioctl(_fd, _request, _arg);
+  } while (r < 0 && errno == EINTR);
+
+  return r;
+}
+
+string fourccToStr(uint32_t _fourcc) {
+  return string{char(_fourcc & 0xff), char((_fourcc >> 8) & 0xff),
+                char((_fourcc >> 16) & 0xff), char((_fourcc >> 24) & 0xff)};
+}
+
+}  // namespace
+
+struct V4l2Device::Stream {
+  int fd;
+  vector<pair<void *, size_t>> buffers;
+  mutex mtx;
+  bool streaming;
+  int queued;
+
+  explicit Stream(int _fd) : fd(_fd), streaming(false), queued(0) {}
+
+  ~Stream() {
+    for (auto &b : buffers) munmap(b.first, b.second);
+
+    close(fd);
+  }
+
+  void queue(int _index) {
+    unique_lock<mutex> lck(mtx);
+
+    // Buffers are not given back after stream off
+    if (!streaming) return;
+
+    v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = _index;
+
+    if (xioctl(fd, VIDIOC_QBUF, &buf) < 0)
+      BOOST_LOG_TRIVIAL(warning)
+          << "V4l2Device: can not queue buffer: " << strerror(errno);
+    else
+      ++queued;
+  }
+};
+
+V4l2Device::V4l2Device(const string &_path, int _width, int _height,
+                       const string &_fourcc, int _fps, int _buffers)
+    : mPath(_path), mFailed(false), mFormat(0), mBytesPerLine(0) {
+  if (!open(_width, _height, _fourcc, _fps, _buffers)) mStream.reset();
+}
+
+V4l2Device::~V4l2Device() {
+  if (!mStream) return;
+
+  unique_lock<mutex> lck(mStream->mtx);
+
+  // Buffers held by the pipeline stay mapped until their leases are released
+  int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  xioctl(mStream->fd, VIDIOC_STREAMOFF, &type);
+  mStream->streaming = false;
+}
+
+bool V4l2Device::open(int _width, int _height, const string &_fourcc,
+                      int _fps, int _buffers) {
+  int fd = ::open(mPath.c_str(), O_RDWR | O_NONBLOCK);
+
+  if (fd < 0) {
+    BOOST_LOG_TRIVIAL(error) << "V4l2Device: can not open " << mPath << ": "
+                             << strerror(errno);
+    return false;
+  }
+
+  // Closes device on any failure below
+  mStream = make_shared<Stream>(fd);
+
+  v4l2_capability cap;
+  memset(&cap, 0, sizeof(cap));
+
+  if (xioctl(fd, VIDIOC_QUERYCAP, &cap) < 0) {
+    BOOST_LOG_TRIVIAL(error) << "V4l2Device: " << mPath
+                             << " is not a V4L2 device: " << strerror(errno);
+    return false;
+  }
+
+  uint32_t caps = cap.capabilities & V4L2_CAP_DEVICE_CAPS ? cap.device_caps
+                                                         : cap.capabilities;
+
+  if (!(caps & V4L2_CAP_VIDEO_CAPTURE) || !(caps & V4L2_CAP_STREAMING)) {
+    BOOST_LOG_TRIVIAL(error) << "V4l2Device: " << mPath
+                             << " does not support streaming capture";
+    return false;
+  }
+
+  v4l2_format fmt;
+  memset(&fmt, 0, sizeof(fmt));
+  fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+  if (xioctl(fd, VIDIOC_G_FMT, &fmt) < 0) {
+    BOOST_LOG_TRIVIAL(error) << "V4l2Device: can not get format of " << mPath
+                             << ": " << strerror(errno);
+    return false;
+  }
+
+  fmt.fmt.pix.pixelformat = chooseFormat(_fourcc);
+
+  if (fmt.fmt.pix.pixelformat == 0) {
+    BOOST_LOG_TRIVIAL(error) << "V4l2Device: " << mPath
+                             << " has no BGR24, MJPEG, YUYV or GREY format";
+    return false;
+  }
+
+  if (_width > 0) fmt.fmt.pix.width = _width;
+  if (_height > 0) fmt.fmt.pix.height = _height;
+  fmt.fmt.pix.field = V4L2_FIELD_NONE;
+  // Driver computes it for the new size
+  fmt.fmt.pix.bytesperline = 0;
+
+  // Driver adjusts size to the nearest supported one
+  if (xioctl(fd, VIDIOC_S_FMT, &fmt) < 0) {
+    BOOST_LOG_TRIVIAL(error) << "V4l2Device: can not set format of " << mPath
+                             << ": " << strerror(errno);
+    return false;
+  }
+
+  mFormat = fmt.fmt.pix.pixelformat;
+  mSize = Size(fmt.fmt.pix.width, fmt.fmt.pix.height);
+  mBytesPerLine = fmt.fmt.pix.bytesperline;
+
+  if (find(begin(knownFormats), end(knownFormats), mFormat) ==
+      end(knownFormats)) {
+    BOOST_LOG_TRIVIAL(error) << "V4l2Device: " << mPath << " has set format "
+                             << fourccToStr(mFormat) << " instead";
+    return false;
+  }
+
+  if (_fps > 0) {
+    v4l2_streamparm parm;
+    memset(&parm, 0, sizeof(parm));
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+    if (xioctl(fd, VIDIOC_G_PARM, &parm) == 0 &&
+        parm.parm.capture.capability & V4L2_CAP_TIMEPERFRAME) {
+      parm.parm.capture.timeperframe.numerator = 1;
+      parm.parm.capture.timeperframe.denominator = _fps;
+
+      if (xioctl(fd, VIDIOC_S_PARM, &parm) < 0)
+        BOOST_LOG_TRIVIAL(warning) << "V4l2Device: can not set fps of "
+                                   << mPath << ": " << strerror(errno);
+    }
+  }
+
+  v4l2_requestbuffers req;
+  memset(&req, 0, sizeof(req));
+  req.count = _buffers;
+  req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  req.memory = V4L2_MEMORY_MMAP;
+
+  if (xioctl(fd, VIDIOC_REQBUFS, &req) < 0 || req.count < 2) {
+    BOOST_LOG_TRIVIAL(error) << "V4l2Device: can not get buffers of " << mPath
+                             << ": " << strerror(errno);
+    return false;
+  }
+
+  for (uint32_t i = 0; i < req.count; ++i) {
+    v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = i;
+
+    if (xioctl(fd, VIDIOC_QUERYBUF, &buf) < 0) {
+      BOOST_LOG_TRIVIAL(error) << "V4l2Device: can not query buffer of "
+                               << mPath << ": " << strerror(errno);
+      return false;
+    }
+
+    void *start = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, buf.m.offset);
+
+    if (start == MAP_FAILED) {
+      BOOST_LOG_TRIVIAL(error) << "V4l2Device: can not map buffer of "
+                               << mPath << ": " << strerror(errno);
+      return false;
+    }
+
+    mStream->buffers.push_back(make_pair(start, size_t(buf.length)));
+  }
+
+  mStream->streaming = true;
+
+  for (size_t i = 0; i < mStream->buffers.size(); ++i) mStream->queue(i);
+
+  int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+  if (xioctl(fd, VIDIOC_STREAMON, &type) < 0) {
+    BOOST_LOG_TRIVIAL(error) << "V4l2Device: can not start stream of "
+                             << mPath << ": " << strerror(errno);
+    return false;
+  }
+
+  BOOST_LOG_TRIVIAL(info) << "V4l2Device: " << mPath << " " << mSize.width
+                          << "x" << mSize.height << " "
+                          << fourccToStr(mFormat) << ", "
+                          << mStream->buffers.size() << " buffers";
+
+  return true;
+}
+
+uint32_t V4l2Device::chooseFormat(const string &_fourcc) const {
+  vector<uint32_t> formats;
+
+  v4l2_fmtdesc desc;
+  memset(&desc, 0, sizeof(desc));
+  desc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+  while (xioctl(mStream->fd, VIDIOC_ENUM_FMT, &desc) == 0) {
+    formats.push_back(desc.pixelformat);
+    ++desc.index;
+  }
+
+  auto supported = [&formats](uint32_t _format) {
+    return find(begin(knownFormats), end(knownFormats), _format) !=
+               end(knownFormats) &&
+           find(formats.begin(), formats.end(), _format) != formats.end();
+  };
+
+  if (_fourcc.length() == 4) {
+    uint32_t requested =
+        v4l2_fourcc(_fourcc[0], _fourcc[1], _fourcc[2], _fourcc[3]);
+
+    if (supported(requested)) return requested;
+
+    BOOST_LOG_TRIVIAL(warning) << "V4l2Device: " << mPath << " has no "
+                               << _fourcc << " format";
+  }
+
+  for (uint32_t f : knownFormats)
+    if (supported(f)) return f;
+
+  return 0;
+}
+
+bool V4l2Device::read(Frame &_frame, int _timeoutMs, bool _latest) {
+  if (!isOpened()) return false;
+
+  pollfd pfd;
+  pfd.fd = mStream->fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+
+  int r = poll(&pfd, 1, _timeoutMs);
+
+  if (r < 0 && errno != EINTR) {
+    BOOST_LOG_TRIVIAL(error) << "V4l2Device: can not wait for " << mPath
+                             << ": " << strerror(errno);
+    mFailed = true;
+  }
+
+  if (r <= 0) return false;
+
+  v4l2_buffer buf;
+
+  if (!dequeue(buf)) return false;
+
+  // Older ready frames are given back at once
+  if (_latest) {
+    v4l2_buffer next;
+
+    while (dequeue(next)) {
+      mStream->queue(buf.index);
+      buf = next;
+    }
+  }
+
+  auto stream = mStream;
+  int index = buf.index;
+  shared_ptr<void> lease(stream.get(),
+                         [stream, index](void *) { stream->queue(index); });
+
+  if (buf.flags & V4L2_BUF_FLAG_ERROR) {
+    BOOST_LOG_TRIVIAL(warning) << "V4l2Device: broken frame has been skipped";
+    return false;
+  }
+
+  void *data = mStream->buffers[index].first;
+
+  _frame.compressed =
+      mFormat == V4L2_PIX_FMT_MJPEG || mFormat == V4L2_PIX_FMT_JPEG;
+
+  switch (mFormat) {
+    case V4L2_PIX_FMT_BGR24:
+      _frame.image = Mat(mSize, CV_8UC3, data, mBytesPerLine);
+      break;
+    case V4L2_PIX_FMT_YUYV:
+      _frame.image = Mat(mSize, CV_8UC2, data, mBytesPerLine);
+      break;
+    case V4L2_PIX_FMT_GREY:
+      _frame.image = Mat(mSize, CV_8UC1, data, mBytesPerLine);
+      break;
+    default:
+      _frame.image = Mat(1, buf.bytesused, CV_8UC1, data);
+  }
+
+  _frame.lease = move(lease);
+  _frame.timestamp = chrono::system_clock::now();
+
+  // Monotonic time of capture is moved to system clock by its age
+  if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) ==
+      V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    long long ageUs = (now.tv_sec - buf.timestamp.tv_sec) * 1000000LL +
+                      now.tv_nsec / 1000 - buf.timestamp.tv_usec;
+
+    if (ageUs > 0) _frame.timestamp -= chrono::microseconds(ageUs);
+  }
+
+  return true;
+}
+
+Mat V4l2Device::bgr(Frame &_frame) {
+  Mat image;
+
+  if (mFormat == V4L2_PIX_FMT_BGR24) {
+    unique_lock<mutex> lck(mStream->mtx);
+
+    if (mStream->queued >= reservedBuffers) return _frame.image;
+
+    lck.unlock();
+    image = _frame.image.clone();
+  } else if (mFormat == V4L2_PIX_FMT_YUYV) {
+    cvtColor(_frame.image, image, COLOR_YUV2BGR_YUYV);
+  } else {
+    cvtColor(_frame.image, image, COLOR_GRAY2BGR);
+  }
+
+  _frame.image = image;
+  _frame.lease.reset();
+
+  return image;
+}
+
+bool V4l2Device::dequeue(v4l2_buffer &_buffer) {
+  memset(&_buffer, 0, sizeof(_buffer));
+  _buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  _buffer.memory = V4L2_MEMORY_MMAP;
+
+  unique_lock<mutex> lck(mStream->mtx);
+
+  if (xioctl(mStream->fd, VIDIOC_DQBUF, &_buffer) < 0) {
+    if (errno != EAGAIN) {
+      BOOST_LOG_TRIVIAL(error) << "V4l2Device: can not read " << mPath << ": "
+                               << strerror(errno);
+      mFailed = true;
+    }
+
+    return false;
+  }
+
+  --mStream->queued;
+
+  return true;
+}
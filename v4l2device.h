@@ -0,0 +1,65 @@
+#ifndef V4L2DEVICE_H
+#define V4L2DEVICE_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <opencv2/core/core.hpp>
+#include <string>
+
+struct v4l2_buffer;
+
+// Linux video device streaming into mmap'ed driver buffers. Frames are given
+// as Mats right over driver buffers, each with a lease: buffer is queued back
+// to driver, when the last copy of the lease is released. So BGR24 frame may
+// travel through the whole pipeline without a copy. Other formats are
+// converted to BGR (YUYV, GREY) or copied by caller (MJPEG), and their
+// buffers are queued back at once.
+class V4l2Device {
+ public:
+  struct Frame {
+    cv::Mat image;  // Over driver buffer, one row of bytes if compressed
+    bool compressed;
+    std::shared_ptr<void> lease;  // Keeps image memory
+    // Driver time of the frame, it does not include delays of reading
+    std::chrono::time_point<std::chrono::system_clock> timestamp;
+  };
+
+  // _fourcc is preferred format, if the device supports it. Non positive
+  // _width, _height or _fps keep the current ones.
+  explicit V4l2Device(const std::string &_path, int _width, int _height,
+                      const std::string &_fourcc, int _fps, int _buffers);
+  virtual ~V4l2Device();
+
+  // False if the device can not be opened or has failed, it should be
+  // reopened then
+  bool isOpened() const { return mStream != nullptr && !mFailed; }
+
+  // Waits for a frame not longer than _timeoutMs. If _latest, all ready
+  // frames are dequeued and only the newest one is returned.
+  bool read(Frame &_frame, int _timeoutMs, bool _latest);
+
+  // BGR image of not compressed _frame. BGR24 frame is given as is, unless
+  // too few buffers are left queued in driver, because the pipeline holds the
+  // rest. Then and for other formats it is a copy and _frame lease is
+  // released.
+  cv::Mat bgr(Frame &_frame);
+
+ private:
+  struct Stream;
+
+  std::string mPath;
+  std::shared_ptr<Stream> mStream;  // Shared with leases, so outlives device
+  bool mFailed;
+  uint32_t mFormat;
+  cv::Size mSize;
+  size_t mBytesPerLine;
+
+  bool open(int _width, int _height, const std::string &_fourcc, int _fps,
+            int _buffers);
+  uint32_t chooseFormat(const std::string &_fourcc) const;
+  // Not blocking, false if no frame is ready
+  bool dequeue(v4l2_buffer &_buffer);
+};
+
+#endif  // V4L2DEVICE_H
@@ -2,7 +2,7 @@
 #define VERIFIERS_ABSTRACTVERIFIER_H
 
 #include <functional>
-#include <list>
+#include <vector>
 
 #include "trackers/abstracttracker.h"
 
@@ -13,8 +13,8 @@ class AbstractVerifier {
   explicit AbstractVerifier() {}
   virtual ~AbstractVerifier() {}
 
-  virtual void verify(std::list<TrackedItem>& _t,
-                      const std::list<RecognizedItem>& _r,
+  virtual void verify(FrameVector<TrackedItem>& _t,
+                      const FrameVector<RecognizedItem>& _r,
                       ItemFilterFunction _weakFitFunc,
                       ItemFilterFunction _strongFitFunc) = 0;
 };
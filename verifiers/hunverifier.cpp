@@ -1,113 +1,273 @@
 #include "verifiers/hunverifier.h"
 
 #include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <chrono>
+#include <cmath>
 #include <limits>
-#include <set>
-#include <vector>
-
-#include "verifiers/hungarian.h"
 
 using namespace cv;
 using namespace std;
 
 namespace {
 
-// Computes IOU between two bounding boxes
-double getIOU2(const cv::Rect2d &bb_test, const cv::Rect2d &bb_gt) {
-  double in = (bb_test & bb_gt).area();
-  double un = bb_test.area() + bb_gt.area() - in;
-
-  return un < std::numeric_limits<double>::epsilon() ? 0.0 : in / un;
-}
+// Grid is not bigger than this number of cells per side
+const int maxGridSide = 128;
 
 }  // namespace
 
 HunVerifier::HunVerifier(double _threshold, int _maxRecFails)
     : AbstractVerifier(), mThreshold(_threshold), mMaxRecFails(_maxRecFails) {}
 
-void HunVerifier::verify(list<TrackedItem> &_t, const list<RecognizedItem> &_r,
+void HunVerifier::verify(FrameVector<TrackedItem> &_t,
+                         const FrameVector<RecognizedItem> &_r,
                          ItemFilterFunction _weakFitFunc,
                          ItemFilterFunction _strongFitFunc) {
-  vector<vector<double>> iouMatrix(_t.size(), vector<double>(_r.size(), 0.0));
-
-  for (auto it_t = _t.begin(); it_t != _t.end(); ++it_t)
-    for (auto it_r = _r.begin(); it_r != _r.end(); ++it_r)
-      iouMatrix[distance(_t.begin(), it_t)][distance(_r.begin(), it_r)] =
-          _weakFitFunc(*it_r) ? 1.0 - getIOU2(it_t->rect, it_r->rect) : 1.0;
-
-  // solve the assignment problem using hungarian algorithm.
-  // the resulting assignment is [track(prediction) : detection], with
-  // len=preNum
-  vector<int> assignment;
-  Hungarian::Solve(iouMatrix, assignment);
-
-  set<int> unmatchedTrajectories;
-  set<int> unmatchedDetections;
-  set<int> allItems;
-  set<int> matchedItems;
-
-  if (_r.size() > _t.size())  // there are unmatched detections
-  {
-    for (size_t i = 0; i < _r.size(); ++i) allItems.insert(i);
-
-    for (size_t i = 0; i < _t.size(); ++i) matchedItems.insert(assignment[i]);
-
-    set_difference(allItems.begin(), allItems.end(), matchedItems.begin(),
-                   matchedItems.end(),
-                   insert_iterator<set<int>>(unmatchedDetections,
-                                             unmatchedDetections.begin()));
-  } else if (_r.size() <
-             _t.size())  // there are unmatched trajectory/predictions
-  {
-    for (size_t i = 0; i < _t.size(); ++i)
-      if (assignment[i] ==
-          -1)  // unassigned label will be set as -1 in the assignment algorithm
-        unmatchedTrajectories.insert(i);
+  mTracks.clear();
+  mTrackBoxes.clear();
+  for (auto &t : _t) {
+    mTracks.push_back(&t);
+    mTrackBoxes.push_back(t.rect);
+  }
+
+  mDetections.clear();
+  mDetectionBoxes.clear();
+  mWeakFit.clear();
+  for (const auto &r : _r) {
+    mDetections.push_back(&r);
+    mDetectionBoxes.push_back(r.rect);
+    mWeakFit.push_back(_weakFitFunc(r));
   }
 
-  // filter out matched with low IOU
-  vector<cv::Point> matchedPairs;
+  auto t0 = chrono::steady_clock::now();
+
+  findCandidates();
+  solveComponents();
+
+  BOOST_LOG_TRIVIAL(trace)
+      << "HunVerifier: " << mTracks.size() << "x" << mDetections.size()
+      << " association with " << mCandidates.size() << " candidates in "
+      << chrono::duration_cast<chrono::microseconds>(
+             chrono::steady_clock::now() - t0)
+             .count()
+      << " us";
+
+  mMatched.assign(mDetections.size(), 0);
+
+  // Kept tracks are compacted in place
+  size_t kept = 0;
   for (size_t i = 0; i < _t.size(); ++i) {
-    if (assignment[i] == -1)  // pass over invalid values
+    int j = mTrackMatch[i];
+    auto &t = _t[i];
+
+    // filter out matched with low IOU
+    if (j >= 0 && 1.0 - mTrackMatchCost[i] >= mThreshold) {
+      t.setRecognized(mDetections[j]->type, mDetections[j]->confidence);
+      t.rect = mDetections[j]->rect;
+      t.recFailsCount = 0;
+      mMatched[j] = 1;
+    } else if (t.recFailsCount < mMaxRecFails) {
+      ++t.recFailsCount;
+    } else {
       continue;
+    }
 
-    if (1.0 - iouMatrix[i][assignment[i]] < mThreshold) {
-      unmatchedTrajectories.insert(i);
-      unmatchedDetections.insert(assignment[i]);
-    } else
-      matchedPairs.push_back(cv::Point(i, assignment[i]));
+    if (kept != i) _t[kept] = t;
+    ++kept;
   }
 
-  vector<RecognizedItem> bufr(_r.begin(), _r.end());
-
-  auto it_t = _t.begin();
-  int t_index = 0;
-  while (it_t != _t.end()) {
-    auto p = find_if(matchedPairs.begin(), matchedPairs.end(),
-                     [t_index](const auto &el) { return el.x == t_index; });
-
-    if (p != matchedPairs.end() && p->y >= 0 &&
-        p->y < static_cast<int>(bufr.size()) && _weakFitFunc(bufr[p->y])) {
-      it_t->recType = bufr[p->y].type;
-      it_t->recConfidence = bufr[p->y].confidence;
-      it_t->rect = bufr[p->y].rect;
-      it_t->recFailsCount = 0;
-
-      ++it_t;
-    } else if (it_t->recFailsCount < mMaxRecFails) {
-      // std::cout << "stay for tid = " << it_t->trackId << std::endl;
-      ++(it_t->recFailsCount);
-      ++it_t;
+  _t.resize(kept);
+
+  // New items
+  for (size_t j = 0; j < mDetections.size(); ++j)
+    if (!mMatched[j] && _strongFitFunc(*mDetections[j]))
+      _t.push_back(*mDetections[j]);
+}
+
+void HunVerifier::findCandidates() {
+  int tracks = mTracks.size();
+  int detections = mDetections.size();
+
+  mCandidates.clear();
+  mParent.resize(tracks + detections);
+  for (int x = 0; x < tracks + detections; ++x) mParent[x] = x;
+
+  // Grid covers all detection boxes, cell is about average box size
+  double minX = numeric_limits<double>::max(), minY = minX;
+  double maxX = numeric_limits<double>::lowest(), maxY = maxX;
+  double sumSize = 0.0;
+  int count = 0;
+
+  for (int j = 0; j < detections; ++j)
+    if (mWeakFit[j]) {
+      const auto &r = mDetections[j]->rect;
+      minX = std::min(minX, r.x);
+      minY = std::min(minY, r.y);
+      maxX = std::max(maxX, r.x + r.width);
+      maxY = std::max(maxY, r.y + r.height);
+      sumSize += std::max(r.width, r.height);
+      ++count;
+    }
+
+  if (count == 0 || tracks == 0) return;
+
+  double cell = std::max(sumSize / count, 1.0);
+  cell = std::max(cell, (maxX - minX) / (maxGridSide - 1));
+  cell = std::max(cell, (maxY - minY) / (maxGridSide - 1));
+
+  int gridW = static_cast<int>((maxX - minX) / cell) + 1;
+  int gridH = static_cast<int>((maxY - minY) / cell) + 1;
+
+  // Cells range of box, false if box is out of grid
+  auto cells = [&](const Rect2d &_r, int &_x0, int &_y0, int &_x1, int &_y1) {
+    if (_r.x > maxX || _r.y > maxY || _r.x + _r.width < minX ||
+        _r.y + _r.height < minY)
+      return false;
+
+    _x0 = std::max(static_cast<int>(std::floor((_r.x - minX) / cell)), 0);
+    _y0 = std::max(static_cast<int>(std::floor((_r.y - minY) / cell)), 0);
+    _x1 = std::min(static_cast<int>((_r.x + _r.width - minX) / cell),
+                   gridW - 1);
+    _y1 = std::min(static_cast<int>((_r.y + _r.height - minY) / cell),
+                   gridH - 1);
+    return true;
+  };
+
+  // Counting sort of detections into cells
+  int x0, y0, x1, y1;
+
+  mCellStart.assign(gridW * gridH + 1, 0);
+  for (int j = 0; j < detections; ++j)
+    if (mWeakFit[j] && cells(mDetections[j]->rect, x0, y0, x1, y1))
+      for (int y = y0; y <= y1; ++y)
+        for (int x = x0; x <= x1; ++x) ++mCellStart[y * gridW + x + 1];
+
+  for (int c = 0; c < gridW * gridH; ++c) mCellStart[c + 1] += mCellStart[c];
+
+  mCellItems.resize(mCellStart[gridW * gridH]);
+  mLocal.assign(mCellStart.begin(), mCellStart.end() - 1);  // Fill positions
+  for (int j = 0; j < detections; ++j)
+    if (mWeakFit[j] && cells(mDetections[j]->rect, x0, y0, x1, y1))
+      for (int y = y0; y <= y1; ++y)
+        for (int x = x0; x <= x1; ++x) mCellItems[mLocal[y * gridW + x]++] = j;
+
+  // Overlapping pairs
+  mSeen.assign(detections, -1);
+
+  for (int i = 0; i < tracks; ++i) {
+    const auto &t = mTracks[i]->rect;
+
+    if (!cells(t, x0, y0, x1, y1)) continue;
+
+    // Gather detections near the track, then compute IOU row at once
+    mColBoxes.clear();
+    mRowItems.clear();
+
+    for (int y = y0; y <= y1; ++y)
+      for (int x = x0; x <= x1; ++x)
+        for (int k = mCellStart[y * gridW + x];
+             k < mCellStart[y * gridW + x + 1]; ++k) {
+          int j = mCellItems[k];
+
+          if (mSeen[j] == i) continue;
+          mSeen[j] = i;
+
+          mColBoxes.push_back(mDetectionBoxes, j);
+          mRowItems.push_back(j);
+        }
+
+    mIou.resize(mRowItems.size());
+    computeIouRow(t, mColBoxes, mIou.data());
+
+    for (size_t k = 0; k < mRowItems.size(); ++k)
+      if (mIou[k] > 0.0f) {
+        int j = mRowItems[k];
+        mCandidates.push_back(Candidate{-1, i, j, 1.0 - mIou[k]});
+        mParent[findSet(i)] = findSet(tracks + j);
+      }
+  }
+}
+
+void HunVerifier::solveComponents() {
+  int tracks = mTracks.size();
+  int detections = mDetections.size();
+
+  mTrackMatch.assign(tracks, -1);
+  mTrackMatchCost.assign(tracks, 1.0);
+
+  for (auto &c : mCandidates) c.component = findSet(c.track);
+
+  sort(mCandidates.begin(), mCandidates.end(),
+       [](const Candidate &_a, const Candidate &_b) {
+         return _a.component < _b.component;
+       });
+
+  mLocal.assign(tracks + detections, -1);
+
+  auto begin = mCandidates.begin();
+  while (begin != mCandidates.end()) {
+    auto end = find_if(begin, mCandidates.end(), [begin](const Candidate &_c) {
+      return _c.component != begin->component;
+    });
+
+    mLocalTracks.clear();
+    mLocalDetections.clear();
+
+    for (auto it = begin; it != end; ++it) {
+      if (mLocal[it->track] < 0) {
+        mLocal[it->track] = mLocalTracks.size();
+        mLocalTracks.push_back(it->track);
+      }
+      if (mLocal[tracks + it->detection] < 0) {
+        mLocal[tracks + it->detection] = mLocalDetections.size();
+        mLocalDetections.push_back(it->detection);
+      }
+    }
+
+    int rows = mLocalTracks.size();
+    int cols = mLocalDetections.size();
+
+    if (rows == 1 && cols == 1) {
+      // The most common case, nothing to solve
+      mTrackMatch[begin->track] = begin->detection;
+      mTrackMatchCost[begin->track] = begin->cost;
     } else {
-      _t.erase(it_t++);
+      // Dense IOU matrix of the component, pairs without overlap cost 1
+      mRowBoxes.clear();
+      for (int t : mLocalTracks) mRowBoxes.push_back(mTrackBoxes, t);
+      mColBoxes.clear();
+      for (int d : mLocalDetections) mColBoxes.push_back(mDetectionBoxes, d);
+
+      mIou.resize(rows * cols);
+      computeIouMatrix(mRowBoxes, mColBoxes, mIou.data());
+
+      mCost.resize(rows * cols);
+      for (int k = 0; k < rows * cols; ++k) mCost[k] = 1.0 - mIou[k];
+
+      mSolver.solve(mCost.data(), rows, cols);
+
+      for (int r = 0; r < rows; ++r) {
+        int c = mSolver.rowAssignment()[r];
+
+        if (c >= 0 && mCost[r * cols + c] < 1.0) {
+          mTrackMatch[mLocalTracks[r]] = mLocalDetections[c];
+          mTrackMatchCost[mLocalTracks[r]] = mCost[r * cols + c];
+        }
+      }
     }
 
-    ++t_index;
+    for (int t : mLocalTracks) mLocal[t] = -1;
+    for (int d : mLocalDetections) mLocal[tracks + d] = -1;
+
+    begin = end;
   }
+}
 
-  // New items
-  for (const int &rind : unmatchedDetections)
-    if (rind >= 0 && rind < static_cast<int>(bufr.size()) &&
-        _strongFitFunc(bufr[rind]))
-      _t.push_back(bufr[rind]);
+int HunVerifier::findSet(int _x) {
+  while (mParent[_x] != _x) {
+    mParent[_x] = mParent[mParent[_x]];
+    _x = mParent[_x];
+  }
+
+  return _x;
 }
@@ -2,21 +2,55 @@
 #define VERIFIERS_HUNVERIFIER_H
 
 #include <boost/log/core.hpp>
+#include <vector>
 
 #include "verifiers/abstractverifier.h"
+#include "verifiers/ioukernel.h"
+#include "verifiers/lapsolver.h"
 
+// Tracks and detections are associated only if their boxes overlap.
+// Candidate pairs are found with uniform grid over detection boxes, then
+// every connected component of tracks and detections is solved separately.
 class HunVerifier : public AbstractVerifier {
  public:
   explicit HunVerifier(double _threshold, int _maxRecFails);
 
-  virtual void verify(std::list<TrackedItem>& _t,
-                      const std::list<RecognizedItem>& _r,
+  virtual void verify(FrameVector<TrackedItem>& _t,
+                      const FrameVector<RecognizedItem>& _r,
                       ItemFilterFunction _weakFitFunc,
                       ItemFilterFunction _strongFitFunc) override;
 
  private:
+  struct Candidate {
+    int component, track, detection;
+    double cost;  // 1 - IOU
+  };
+
   double mThreshold;
   int mMaxRecFails;
+
+  // Workspace, kept between calls
+  LapSolver mSolver;
+  std::vector<const TrackedItem*> mTracks;
+  std::vector<const RecognizedItem*> mDetections;
+  std::vector<char> mWeakFit, mMatched;
+  BoxesSoA mTrackBoxes, mDetectionBoxes;
+  BoxesSoA mRowBoxes, mColBoxes;  // Gathered boxes for IOU kernel
+  std::vector<int> mRowItems;     // Detections of mColBoxes for a track
+  std::vector<float> mIou;
+  std::vector<int> mCellStart, mCellItems;  // Grid cells -> detections
+  std::vector<int> mSeen;                   // Last track checked with
+  std::vector<Candidate> mCandidates;
+  std::vector<int> mParent;  // Disjoint sets of tracks, then detections
+  std::vector<int> mLocal;   // Index inside of current component
+  std::vector<int> mLocalTracks, mLocalDetections;
+  std::vector<double> mCost;  // Row-major cost matrix of one component
+  std::vector<int> mTrackMatch;
+  std::vector<double> mTrackMatchCost;
+
+  void findCandidates();
+  void solveComponents();
+  int findSet(int _x);
 };
 
 #endif  // VERIFIERS_HUNVERIFIER_H
@@ -0,0 +1,81 @@
+#include "verifiers/ioukernel.h"
+
+#include <algorithm>
+#include <limits>
+#include <opencv2/core/hal/intrin.hpp>
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+const float eps = numeric_limits<float>::epsilon();
+
+// Boxes from _from to the end
+void iouRowScalar(float _x1, float _y1, float _x2, float _y2, float _area,
+                  const BoxesSoA &_boxes, int _from, float *_iou) {
+  for (int j = _from; j < static_cast<int>(_boxes.size()); ++j) {
+    float w = std::min(_x2, _boxes.x2[j]) - std::max(_x1, _boxes.x1[j]);
+    float h = std::min(_y2, _boxes.y2[j]) - std::max(_y1, _boxes.y1[j]);
+    w = std::max(w, 0.0f);
+    h = std::max(h, 0.0f);
+    float in = w * h;
+    float un = _area + _boxes.area[j] - in;
+
+    _iou[j] = un > eps ? in / un : 0.0f;
+  }
+}
+
+void iouRow(float _x1, float _y1, float _x2, float _y2, float _area,
+            const BoxesSoA &_boxes, float *_iou) {
+  int j = 0;
+
+#if CV_SIMD
+  int n = _boxes.size();
+  const v_float32 x1 = vx_setall_f32(_x1), y1 = vx_setall_f32(_y1);
+  const v_float32 x2 = vx_setall_f32(_x2), y2 = vx_setall_f32(_y2);
+  const v_float32 area = vx_setall_f32(_area);
+  const v_float32 zero = vx_setzero_f32(), veps = vx_setall_f32(eps);
+
+  for (; j + v_float32::nlanes <= n; j += v_float32::nlanes) {
+    v_float32 w = v_max(v_min(x2, vx_load(&_boxes.x2[j])) -
+                            v_max(x1, vx_load(&_boxes.x1[j])),
+                        zero);
+    v_float32 h = v_max(v_min(y2, vx_load(&_boxes.y2[j])) -
+                            v_max(y1, vx_load(&_boxes.y1[j])),
+                        zero);
+    v_float32 in = w * h;
+    v_float32 un = area + vx_load(&_boxes.area[j]) - in;
+
+    // Lanes with empty union are masked out, so division result is ignored
+    v_store(&_iou[j], v_select(un > veps, in / un, zero));
+  }
+
+  vx_cleanup();
+#endif
+
+  // Scalar tail (or whole row without SIMD)
+  iouRowScalar(_x1, _y1, _x2, _y2, _area, _boxes, j, _iou);
+}
+
+}  // namespace
+
+void computeIouRow(const Rect2d &_rect, const BoxesSoA &_boxes, float *_iou) {
+  iouRow(static_cast<float>(_rect.x), static_cast<float>(_rect.y),
+         static_cast<float>(_rect.x + _rect.width),
+         static_cast<float>(_rect.y + _rect.height),
+         static_cast<float>(_rect.area()), _boxes, _iou);
+}
+
+void computeIouMatrix(const BoxesSoA &_a, const BoxesSoA &_b, float *_iou) {
+  for (size_t i = 0; i < _a.size(); ++i)
+    iouRow(_a.x1[i], _a.y1[i], _a.x2[i], _a.y2[i], _a.area[i], _b,
+           _iou + i * _b.size());
+}
+
+void computeIouMatrixScalar(const BoxesSoA &_a, const BoxesSoA &_b,
+                            float *_iou) {
+  for (size_t i = 0; i < _a.size(); ++i)
+    iouRowScalar(_a.x1[i], _a.y1[i], _a.x2[i], _a.y2[i], _a.area[i], _b, 0,
+                 _iou + i * _b.size());
+}
@@ -0,0 +1,50 @@
+#ifndef VERIFIERS_IOUKERNEL_H
+#define VERIFIERS_IOUKERNEL_H
+
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+// Boxes as structure of arrays, for vectorized IOU computation
+struct BoxesSoA {
+  std::vector<float> x1, y1, x2, y2, area;
+
+  void clear() {
+    x1.clear();
+    y1.clear();
+    x2.clear();
+    y2.clear();
+    area.clear();
+  }
+
+  void push_back(const cv::Rect2d &_rect) {
+    x1.push_back(static_cast<float>(_rect.x));
+    y1.push_back(static_cast<float>(_rect.y));
+    x2.push_back(static_cast<float>(_rect.x + _rect.width));
+    y2.push_back(static_cast<float>(_rect.y + _rect.height));
+    area.push_back(static_cast<float>(_rect.area()));
+  }
+
+  // Copies box _i of _from
+  void push_back(const BoxesSoA &_from, size_t _i) {
+    x1.push_back(_from.x1[_i]);
+    y1.push_back(_from.y1[_i]);
+    x2.push_back(_from.x2[_i]);
+    y2.push_back(_from.y2[_i]);
+    area.push_back(_from.area[_i]);
+  }
+
+  size_t size() const { return x1.size(); }
+};
+
+// IOU of _rect with every box of _boxes, _iou must have _boxes.size() items.
+// Uses SIMD if available.
+void computeIouRow(const cv::Rect2d &_rect, const BoxesSoA &_boxes,
+                   float *_iou);
+
+// Row-major _a.size() x _b.size() IOU matrix
+void computeIouMatrix(const BoxesSoA &_a, const BoxesSoA &_b, float *_iou);
+// The same without SIMD, reference for checks
+void computeIouMatrixScalar(const BoxesSoA &_a, const BoxesSoA &_b,
+                            float *_iou);
+
+#endif  // VERIFIERS_IOUKERNEL_H
@@ -0,0 +1,89 @@
+#include "verifiers/lapsolver.h"
+
+#include <limits>
+
+using namespace std;
+
+double LapSolver::solve(const double *_cost, int _rows, int _cols) {
+  mRowToCol.assign(_rows, -1);
+  mColToRow.assign(_cols, -1);
+
+  if (_rows == 0 || _cols == 0) return 0.0;
+
+  // Algorithm needs n <= m, so matrix is transposed if necessary
+  bool transposed = _rows > _cols;
+  int n = transposed ? _cols : _rows;
+  int m = transposed ? _rows : _cols;
+
+  auto cost = [_cost, _cols, transposed](int _i, int _j) {
+    return transposed ? _cost[_j * _cols + _i] : _cost[_i * _cols + _j];
+  };
+
+  const double inf = numeric_limits<double>::infinity();
+
+  // Potentials and matching are 1-based, index 0 is a fictive vertex
+  mU.assign(n + 1, 0.0);
+  mV.assign(m + 1, 0.0);
+  mP.assign(m + 1, 0);
+  mWay.assign(m + 1, 0);
+
+  for (int i = 1; i <= n; ++i) {
+    mP[0] = i;
+    int j0 = 0;
+    mMinV.assign(m + 1, inf);
+    mUsed.assign(m + 1, 0);
+
+    // Dijkstra-like search of the shortest augmenting path from row i
+    do {
+      mUsed[j0] = 1;
+      int i0 = mP[j0], j1 = 0;
+      double delta = inf;
+
+      for (int j = 1; j <= m; ++j)
+        if (!mUsed[j]) {
+          double cur = cost(i0 - 1, j - 1) - mU[i0] - mV[j];
+
+          if (cur < mMinV[j]) {
+            mMinV[j] = cur;
+            mWay[j] = j0;
+          }
+
+          if (mMinV[j] < delta) {
+            delta = mMinV[j];
+            j1 = j;
+          }
+        }
+
+      for (int j = 0; j <= m; ++j)
+        if (mUsed[j]) {
+          mU[mP[j]] += delta;
+          mV[j] -= delta;
+        } else {
+          mMinV[j] -= delta;
+        }
+
+      j0 = j1;
+    } while (mP[j0] != 0);
+
+    // Augmenting along the path
+    do {
+      int j1 = mWay[j0];
+      mP[j0] = mP[j1];
+      j0 = j1;
+    } while (j0 != 0);
+  }
+
+  double total = 0.0;
+
+  for (int j = 1; j <= m; ++j)
+    if (mP[j] != 0) {
+      int row = transposed ? j - 1 : mP[j] - 1;
+      int col = transposed ? mP[j] - 1 : j - 1;
+
+      mRowToCol[row] = col;
+      mColToRow[col] = row;
+      total += _cost[row * _cols + col];
+    }
+
+  return total;
+}
@@ -0,0 +1,29 @@
+#ifndef VERIFIERS_LAPSOLVER_H
+#define VERIFIERS_LAPSOLVER_H
+
+#include <vector>
+
+// Solves rectangular linear assignment problem with shortest augmenting path
+// algorithm (Jonker-Volgenant) in O(n^2 * m). Workspace is kept between
+// calls, so repeated solving of similar sizes does not allocate memory.
+class LapSolver {
+ public:
+  explicit LapSolver() {}
+
+  // _cost is row-major _rows x _cols matrix. Every row (or every column, if
+  // there are less columns than rows) is assigned. Returns total cost.
+  double solve(const double *_cost, int _rows, int _cols);
+
+  // Column of each row, -1 if row is not assigned
+  const std::vector<int> &rowAssignment() const { return mRowToCol; }
+  // Row of each column, -1 if column is not assigned
+  const std::vector<int> &colAssignment() const { return mColToRow; }
+
+ private:
+  std::vector<double> mU, mV, mMinV;
+  std::vector<int> mP, mWay;
+  std::vector<char> mUsed;
+  std::vector<int> mRowToCol, mColToRow;
+};
+
+#endif  // VERIFIERS_LAPSOLVER_H
@@ -0,0 +1,166 @@
+#include "videoencoder.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <opencv2/core/utility.hpp>
+
+using namespace cv;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+// Statistics are logged every this number of encoded frames
+const long statisticsPeriod = 1000;
+// Longer pauses between frames are cut to this, so a stalled pipeline does
+// not make encoder write the same frame for minutes
+const int maxPauseS = 5;
+// Files of the encoder, names sort in time order
+const char segmentPattern[] = "debug_*.avi";
+
+}  // namespace
+
+VideoEncoder::VideoEncoder(const string &_dir, const string &_fourcc,
+                           double _sourceFps, int _segmentS,
+                           size_t _maxSegments, int _decimation,
+                           size_t _queueSize, int _timeoutMs)
+    : mDir(_dir),
+      mFourcc(_fourcc.size() == 4 ? VideoWriter::fourcc(_fourcc[0], _fourcc[1],
+                                                        _fourcc[2], _fourcc[3])
+                                  : VideoWriter::fourcc('M', 'J', 'P', 'G')),
+      mFps((_sourceFps > 0 ? _sourceFps : 10.0) / std::max(_decimation, 1)),
+      mSegmentS(std::max(_segmentS, 1)),
+      mMaxSegments(std::max<size_t>(_maxSegments, 1)),
+      mDecimation(std::max(_decimation, 1)),
+      mQueueSize(std::max<size_t>(_queueSize, 1)),
+      mTimeoutMs(_timeoutMs),
+      mPushed(0),
+      mDropped(0),
+      mSegmentFrames(0),
+      mEncoded(0) {
+  // Files of earlier runs are rotated as well
+  vector<string> files;
+
+  try {
+    glob(mDir.empty() ? segmentPattern : mDir + "/" + segmentPattern, files);
+  } catch (const cv::Exception &e) {
+    BOOST_LOG_TRIVIAL(warning) << "VideoEncoder: can not list " << mDir
+                               << ": " << e.what();
+  }
+
+  sort(files.begin(), files.end());
+  mSegments.assign(files.begin(), files.end());
+
+  if (!mSegments.empty())
+    BOOST_LOG_TRIVIAL(info) << "VideoEncoder: " << mSegments.size()
+                            << " segments of earlier runs are found";
+}
+
+VideoEncoder::~VideoEncoder() { mWriter.release(); }
+
+void VideoEncoder::push(const Mat &_frame) {
+  unique_lock<mutex> lck(mMutex);
+
+  if (mPushed++ % mDecimation != 0) return;
+
+  if (mQueue.size() >= mQueueSize) {
+    mQueue.pop_front();
+    ++mDropped;
+  }
+
+  mQueue.push_back(Frame{_frame, steady_clock::now()});
+
+  mHaveFrame.notify_all();
+}
+
+void VideoEncoder::doWork() {
+  Frame frame;
+
+  {
+    unique_lock<mutex> lck(mMutex);
+
+    if (mQueue.empty()) mHaveFrame.wait_for(lck, milliseconds(mTimeoutMs));
+
+    if (mQueue.empty()) return;
+
+    frame = move(mQueue.front());
+    mQueue.pop_front();
+  }
+
+  if (!mWriter.isOpened() || frame.image.size() != mWriterSize ||
+      frame.timestamp - mSegmentStart >= seconds(mSegmentS))
+    startSegment(frame.image.size(), frame.timestamp);
+
+  if (!mWriter.isOpened()) return;
+
+  // Frame takes the slots from the end of the file up to its time
+  long slot = static_cast<long>(
+      duration<double>(frame.timestamp - mSegmentStart).count() * mFps);
+  long maxRepeats = std::max(static_cast<long>(mFps * maxPauseS), 1L);
+
+  if (slot - mSegmentFrames >= maxRepeats)
+    mSegmentFrames = slot + 1 - maxRepeats;
+
+  do {
+    mWriter.write(frame.image);
+  } while (++mSegmentFrames <= slot);
+
+  if (++mEncoded % statisticsPeriod == 0) {
+    unique_lock<mutex> lck(mMutex);
+
+    BOOST_LOG_TRIVIAL(debug) << "VideoEncoder: " << mEncoded
+                             << " frames encoded, " << mDropped
+                             << " dropped";
+  }
+}
+
+void VideoEncoder::startSegment(const Size &_size,
+                                const time_point<steady_clock> &_start) {
+  mWriter.release();
+
+  mSegmentStart = _start;
+  mSegmentFrames = 0;
+
+  string fileName = segmentName();
+
+  if (!mWriter.open(fileName, mFourcc, mFps, _size)) {
+    BOOST_LOG_TRIVIAL(error) << "VideoEncoder: can not open " << fileName;
+    return;
+  }
+
+  mWriterSize = _size;
+  mSegments.push_back(fileName);
+
+  BOOST_LOG_TRIVIAL(info) << "VideoEncoder: new segment " << fileName;
+
+  // The newest file is the one being written, it is never removed
+  while (mSegments.size() > mMaxSegments) {
+    if (remove(mSegments.front().c_str()) != 0)
+      BOOST_LOG_TRIVIAL(warning)
+          << "VideoEncoder: can not remove " << mSegments.front();
+    mSegments.pop_front();
+  }
+}
+
+string VideoEncoder::segmentName() const {
+  auto now = system_clock::now();
+  time_t t = system_clock::to_time_t(now);
+  auto local = *localtime(&t);
+  char name[64];
+  strftime(name, sizeof(name), "debug_%Y%m%d_%H%M%S", &local);
+
+  long ms = duration_cast<milliseconds>(now.time_since_epoch()).count();
+  string base = (mDir.empty() ? "" : mDir + "/") + name + "_" +
+                to_string(1000 + ms % 1000).substr(1);
+
+  // Names of files in the same millisecond get a number, so an existing file
+  // is never reopened
+  string fileName = base + ".avi";
+  for (int n = 1; ifstream(fileName).good(); ++n)
+    fileName = base + "_" + to_string(n) + ".avi";
+
+  return fileName;
+}
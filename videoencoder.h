@@ -0,0 +1,68 @@
+#ifndef VIDEOENCODER_H
+#define VIDEOENCODER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <opencv2/core/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <string>
+
+// Encodes frames to a rotating set of video files in its own thread. Every
+// _decimation-th pushed frame is queued; if the queue is full, the oldest
+// frame is dropped, so pushing never waits for encoding. A new file is
+// started every _segmentS seconds, only _maxSegments newest files are kept,
+// including files left by earlier runs.
+//
+// Files are written at _sourceFps / _decimation, the rate frames are pushed
+// at most. Frames are placed by the time they are pushed: a frame is
+// repeated to fill the time until the next one, so the video plays at real
+// speed when frames come slower.
+class VideoEncoder {
+ public:
+  explicit VideoEncoder(const std::string &_dir, const std::string &_fourcc,
+                        double _sourceFps, int _segmentS, size_t _maxSegments,
+                        int _decimation, size_t _queueSize, int _timeoutMs);
+  virtual ~VideoEncoder();
+
+  // _frame must not be modified after pushing
+  void push(const cv::Mat &_frame);
+
+  void doWork();
+
+ protected:
+  std::string mDir;
+  int mFourcc;
+  double mFps;
+  int mSegmentS;
+  size_t mMaxSegments;
+  int mDecimation;
+  size_t mQueueSize;
+  int mTimeoutMs;
+
+  struct Frame {
+    cv::Mat image;
+    std::chrono::time_point<std::chrono::steady_clock> timestamp;
+  };
+
+  std::deque<Frame> mQueue;
+  long mPushed, mDropped;
+  std::mutex mMutex;
+  std::condition_variable mHaveFrame;
+
+  cv::VideoWriter mWriter;
+  cv::Size mWriterSize;
+  std::chrono::time_point<std::chrono::steady_clock> mSegmentStart;
+  long mSegmentFrames;  // Written to current file, repeats included
+  std::deque<std::string> mSegments;  // Files, the oldest first
+  long mEncoded;
+
+  void startSegment(
+      const cv::Size &_size,
+      const std::chrono::time_point<std::chrono::steady_clock> &_start);
+  // Local time with milliseconds, unique in mDir
+  std::string segmentName() const;
+};
+
+#endif  // VIDEOENCODER_H
@@ -0,0 +1,38 @@
+#include "videoencoderfactory.h"
+
+using namespace std;
+using namespace nlohmann;
+
+shared_ptr<VideoEncoder> VideoEncoderFactory::createVideoEncoder(
+    const json &_config, double _sourceFps) {
+  bool on = _config.contains("on") && _config["on"].is_boolean()
+                ? _config["on"].get<bool>()
+                : false;
+
+  if (!on) return nullptr;
+
+  return shared_ptr<VideoEncoder>(new VideoEncoder(
+      _config.contains("dir") && _config["dir"].is_string()
+          ? _config["dir"].get<string>()
+          : "",
+      _config.contains("fourcc") && _config["fourcc"].is_string()
+          ? _config["fourcc"].get<string>()
+          : "MJPG",
+      _sourceFps,
+      _config.contains("segmentSeconds") &&
+              _config["segmentSeconds"].is_number()
+          ? _config["segmentSeconds"].get<int>()
+          : 600,
+      _config.contains("maxSegments") && _config["maxSegments"].is_number()
+          ? _config["maxSegments"].get<size_t>()
+          : 12,
+      _config.contains("decimation") && _config["decimation"].is_number()
+          ? _config["decimation"].get<int>()
+          : 1,
+      _config.contains("queueSize") && _config["queueSize"].is_number()
+          ? _config["queueSize"].get<size_t>()
+          : 8,
+      _config.contains("waitTimeoutMs") && _config["waitTimeoutMs"].is_number()
+          ? _config["waitTimeoutMs"].get<int>()
+          : 200));
+}
@@ -0,0 +1,21 @@
+#ifndef VIDEOENCODERFACTORY_H
+#define VIDEOENCODERFACTORY_H
+
+#include <memory>
+#include <nlohmann/json.hpp>
+
+#include "videoencoder.h"
+
+class VideoEncoderFactory {
+ public:
+  virtual ~VideoEncoderFactory() {}
+
+  // _sourceFps is the most frequent rate of pushed frames
+  static std::shared_ptr<VideoEncoder> createVideoEncoder(
+      const nlohmann::json &_config, double _sourceFps);
+
+ private:
+  explicit VideoEncoderFactory() {}
+};
+
+#endif  // VIDEOENCODERFACTORY_H
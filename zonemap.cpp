@@ -0,0 +1,77 @@
+#include "zonemap.h"
+
+#include <algorithm>
+#include <boost/log/trivial.hpp>
+#include <limits>
+#include <opencv2/imgproc.hpp>
+
+using namespace cv;
+using namespace std;
+
+namespace {
+
+// Subpixel bits of polygon vertices for fillPoly
+const int shift = 8;
+
+}  // namespace
+
+ZoneMap::ZoneMap(const vector<vector<Point2d>> &_zones, int _cellSize)
+    : mZones(_zones.size() > maxZones
+                 ? vector<vector<Point2d>>(_zones.begin(),
+                                           _zones.begin() + maxZones)
+                 : _zones),
+      mInvCellSize(1.0 / std::max(_cellSize, 1)),
+      mGridWidth(0),
+      mGridHeight(0) {
+  if (_zones.size() > maxZones)
+    BOOST_LOG_TRIVIAL(error) << "ZoneMap: only " << maxZones << " of "
+                             << _zones.size() << " zones are counted";
+
+  double minX = numeric_limits<double>::max(), minY = minX;
+  double maxX = numeric_limits<double>::lowest(), maxY = maxX;
+
+  for (const auto &z : mZones)
+    for (const auto &p : z) {
+      minX = std::min(minX, p.x);
+      minY = std::min(minY, p.y);
+      maxX = std::max(maxX, p.x);
+      maxY = std::max(maxY, p.y);
+    }
+
+  if (minX > maxX) return;  // No points at all
+
+  mOrigin = Point2d(minX, minY);
+  mGridWidth = cvFloor((maxX - minX) * mInvCellSize) + 1;
+  mGridHeight = cvFloor((maxY - minY) * mInvCellSize) + 1;
+  mCells.assign(mGridWidth * mGridHeight, 0);
+
+  Mat mask(mGridHeight, mGridWidth, CV_8UC1);
+
+  for (size_t i = 0; i < mZones.size(); ++i) {
+    if (mZones[i].size() < 3) {
+      BOOST_LOG_TRIVIAL(error) << "ZoneMap: zone " << i
+                               << " has less than 3 points and is ignored";
+      continue;
+    }
+
+    // Grid coordinates with subpixel precision
+    double scale = mInvCellSize * (1 << shift);
+    vector<Point> poly;
+    for (const auto &p : mZones[i])
+      poly.push_back(
+          Point(cvRound((p.x - minX) * scale), cvRound((p.y - minY) * scale)));
+
+    mask.setTo(Scalar(0));
+    fillPoly(mask, vector<vector<Point>>{poly}, Scalar(1), LINE_8, shift);
+
+    for (int y = 0; y < mGridHeight; ++y) {
+      const uchar *row = mask.ptr<uchar>(y);
+      for (int x = 0; x < mGridWidth; ++x)
+        if (row[x]) mCells[y * mGridWidth + x] |= uint64_t(1) << i;
+    }
+  }
+
+  BOOST_LOG_TRIVIAL(debug) << "ZoneMap: " << mZones.size()
+                           << " zones rasterised into " << mGridWidth << "x"
+                           << mGridHeight << " cells";
+}
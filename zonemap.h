@@ -0,0 +1,39 @@
+#ifndef ZONEMAP_H
+#define ZONEMAP_H
+
+#include <cstdint>
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+// Point -> zones lookup. Polygonal zones are rasterised once into a grid of
+// _cellSize x _cellSize pixel cells covering all zones, every cell keeps a
+// bitmask of zones it belongs to, so zones may overlap.
+class ZoneMap {
+ public:
+  // Zones beyond this number are ignored
+  static const size_t maxZones = 64;
+
+  explicit ZoneMap(const std::vector<std::vector<cv::Point2d>> &_zones,
+                   int _cellSize);
+
+  // Bit i is set if _point is inside zone i
+  uint64_t lookup(const cv::Point2d &_point) const {
+    int x = cvFloor((_point.x - mOrigin.x) * mInvCellSize);
+    int y = cvFloor((_point.y - mOrigin.y) * mInvCellSize);
+
+    if (x < 0 || y < 0 || x >= mGridWidth || y >= mGridHeight) return 0;
+
+    return mCells[y * mGridWidth + x];
+  }
+
+  const std::vector<std::vector<cv::Point2d>> &zones() const { return mZones; }
+
+ private:
+  std::vector<std::vector<cv::Point2d>> mZones;
+  cv::Point2d mOrigin;  // Top left corner of grid
+  double mInvCellSize;
+  int mGridWidth, mGridHeight;
+  std::vector<uint64_t> mCells;
+};
+
+#endif  // ZONEMAP_H